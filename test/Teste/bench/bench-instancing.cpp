@@ -0,0 +1,137 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Instancing: CPU submission cost of many copies of one mesh
+//
+// Copyright (c) 2023-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#define BENCH_GL
+#include "bench.hpp"
+
+#include <string>
+#include <vector>
+
+#include "mgl/mgl.hpp"
+
+// The same mesh is drawn N times per frame in three ways: one draw call per
+// copy setting ModelMatrix (as SceneNode::draw did), one InstanceBuffer draw,
+// and IndirectRenderer::submit()/flush(), which sorts the draws and merges
+// them into one instanced indirect command. Only the time spent issuing the
+// frame is measured; the GPU is drained before the next frame. As in
+// bench-layouts, the camera block is unbound and nothing is rasterized.
+
+const size_t COUNTS[] = {10000, 100000, 1000000};
+
+static void addAttributes(mgl::ShaderProgram& shader) {
+    shader.addAttribute(mgl::POSITION_ATTRIBUTE, mgl::Mesh::POSITION);
+    shader.addAttribute(mgl::NORMAL_ATTRIBUTE, mgl::Mesh::NORMAL);
+    shader.addAttribute(mgl::TEXCOORD_ATTRIBUTE, mgl::Mesh::TEXCOORD);
+}
+
+// Best CPU time of submit() over a few frames, in seconds.
+template <typename F>
+double measureFrame(mgl::StreamBuffer& stream, F submit) {
+    double best = 1e30;
+    for (int i = 0; i < 3; i++) {
+        const bench::clock::time_point start = bench::clock::now();
+        submit();
+        const double seconds =
+            std::chrono::duration<double>(bench::clock::now() - start).count();
+        best = std::min(best, seconds);
+        glFinish();
+        stream.endFrame();
+    }
+    return best;
+}
+
+static void report(size_t count, const char* path, double seconds,
+                   size_t calls) {
+    std::printf("%10zu %-10s %12.2f %12.1f %10zu\n", count, path,
+                seconds * 1e3, seconds / count * 1e9, calls);
+}
+
+int main(int argc, char* argv[]) {
+    const std::string models = argc > 1 ? argv[1] : "../models/";
+    GLFWwindow* window = bench::createContext(4, 6);
+
+    mgl::Mesh mesh;
+    mesh.joinIdenticalVertices();
+    mesh.create(models + "Cube.obj");
+    mgl::StreamBuffer stream(64 * 1024);
+
+    mgl::ShaderProgram direct;
+    direct.addShader(GL_VERTEX_SHADER, "../cube-vs.glsl");
+    direct.addShader(GL_FRAGMENT_SHADER, "../cube-fs.glsl");
+    addAttributes(direct);
+    direct.addUniform(mgl::MODEL_MATRIX);
+    direct.create();
+    const mgl::Uniform<glm::mat4> model_matrix =
+        direct.getUniform<glm::mat4>(mgl::MODEL_MATRIX);
+
+    mgl::ShaderProgram instanced;
+    instanced.addShader(GL_VERTEX_SHADER, "../cube-instanced-vs.glsl");
+    instanced.addShader(GL_FRAGMENT_SHADER, "../cube-instanced-fs.glsl");
+    addAttributes(instanced);
+    instanced.addAttribute(mgl::INSTANCE_MATRIX_ATTRIBUTE,
+                           mgl::Mesh::INSTANCE_MATRIX);
+    instanced.addAttribute(mgl::INSTANCE_COLOR_ATTRIBUTE,
+                           mgl::Mesh::INSTANCE_COLOR);
+    instanced.create();
+
+    mgl::IndirectRenderer renderer(&stream);
+    mgl::ShaderProgram indirect;
+    if (renderer.isIndirect()) {
+        indirect.addShader(GL_VERTEX_SHADER, "../cube-mdi-vs.glsl");
+        indirect.addShader(GL_FRAGMENT_SHADER, "../cube-instanced-fs.glsl");
+        addAttributes(indirect);
+        indirect.create();
+    }
+
+    std::printf("%10s %-10s %12s %12s %10s\n", "instances", "path",
+                "cpu (ms)", "ns/instance", "calls");
+    for (size_t count : COUNTS) {
+        std::vector<glm::mat4> matrices(count);
+        for (size_t i = 0; i < count; i++) {
+            const glm::vec3 position(i % 100, (i / 100) % 100, i / 10000);
+            matrices[i] = glm::translate(glm::mat4(1.0f), position);
+        }
+        const glm::vec3 color(1.0f, 0.5f, 0.25f);
+
+        double seconds = measureFrame(stream, [&]() {
+            direct.bind();
+            for (size_t i = 0; i < count; i++) {
+                direct.set(model_matrix, matrices[i]);
+                mesh.draw();
+            }
+        });
+        report(count, "per-draw", seconds, count);
+
+        mgl::InstanceBuffer instances(&stream);
+        seconds = measureFrame(stream, [&]() {
+            instanced.bind();
+            instances.clear();
+            for (size_t i = 0; i < count; i++) {
+                instances.add(matrices[i], color);
+            }
+            instances.draw(&mesh);
+        });
+        const size_t chunk = stream.getFrameSize() / sizeof(mgl::InstanceData);
+        report(count, "instanced", seconds, (count + chunk - 1) / chunk);
+
+        if (renderer.isIndirect()) {
+            seconds = measureFrame(stream, [&]() {
+                for (size_t i = 0; i < count; i++) {
+                    renderer.submit(&mesh, &indirect, matrices[i], color);
+                }
+                renderer.flush();
+            });
+            report(count, "indirect", seconds,
+                   renderer.getStats().drawCalls);
+        }
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Vertex layouts: upload time and vertex fetch throughput
+//
+// Copyright (c) 2023-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#define BENCH_GL
+#include "bench.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mgl/mgl.hpp"
+
+// Each model is loaded once per layout, then uploaded several times and drawn
+// many times per call with cube-vs.glsl. The models are small, so the draws
+// are instanced to make the GPU time depend on vertex fetch and not on the
+// number of calls. The camera block is left unbound: every triangle is
+// degenerate and nothing is rasterized, but every vertex is still fetched.
+
+const char* MODELS[] = {"Cube.obj", "Para.obj", "TriangleFix.obj",
+                        "cube-vtn-flat.obj"};
+const GLsizei INSTANCES = 20000;
+
+const struct {
+    mgl::Mesh::VertexLayout layout;
+    const char* name;
+} LAYOUTS[] = {{mgl::Mesh::SEPARATE, "separate"},
+               {mgl::Mesh::INTERLEAVED, "interleaved"},
+               {mgl::Mesh::SPLIT_POSITION, "split-position"}};
+
+static std::unique_ptr<mgl::Mesh> loadMesh(const std::string& filename,
+                                           mgl::Mesh::VertexLayout layout) {
+    std::unique_ptr<mgl::Mesh> mesh(new mgl::Mesh());
+    mesh->joinIdenticalVertices();
+    mesh->setVertexLayout(layout);
+    mesh->load(filename);
+    return mesh;
+}
+
+int main(int argc, char* argv[]) {
+    const std::string models = argc > 1 ? argv[1] : "../models/";
+    GLFWwindow* window = bench::createContext(3, 3);
+
+    mgl::ShaderProgram shader;
+    shader.addShader(GL_VERTEX_SHADER, "../cube-vs.glsl");
+    shader.addShader(GL_FRAGMENT_SHADER, "../cube-fs.glsl");
+    shader.addAttribute(mgl::POSITION_ATTRIBUTE, mgl::Mesh::POSITION);
+    shader.addAttribute(mgl::NORMAL_ATTRIBUTE, mgl::Mesh::NORMAL);
+    shader.addAttribute(mgl::TEXCOORD_ATTRIBUTE, mgl::Mesh::TEXCOORD);
+    shader.create();
+    shader.bind();
+
+    std::printf("%-18s %-15s %10s %12s %14s\n", "model", "layout", "vertices",
+                "upload (us)", "Mvertices/s");
+    for (const char* model : MODELS) {
+        for (const auto& layout : LAYOUTS) {
+            const std::string filename = models + model;
+            // Upload into fresh meshes so that every run allocates buffers.
+            std::vector<std::unique_ptr<mgl::Mesh>> meshes;
+            for (int i = 0; i < 5; i++) {
+                meshes.push_back(loadMesh(filename, layout.layout));
+            }
+            size_t next = 0;
+            const double upload = bench::measure([&]() {
+                meshes[next++]->upload();
+                glFinish();
+            });
+
+            mgl::Mesh& mesh = *meshes[0];
+            std::vector<mgl::Mesh::DrawCommand> commands;
+            mesh.getDrawCommands(commands);
+            size_t vertices = 0;
+            for (const mgl::Mesh::DrawCommand& command : commands) {
+                vertices += command.count;
+            }
+            mesh.drawInstanced(INSTANCES);  // warm up
+            double gpu = 1e30;
+            for (int i = 0; i < 5; i++) {
+                gpu = std::min(gpu, bench::measureGpu([&]() {
+                    mesh.drawInstanced(INSTANCES);
+                }));
+            }
+            std::printf("%-18s %-15s %10zu %12.1f %14.1f\n", model,
+                        layout.name, vertices, upload * 1e6,
+                        vertices * INSTANCES / gpu * 1e-6);
+        }
+    }
+
+    shader.unbind();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,83 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// MeshLoader: load time of N assets against the number of threads
+//
+// Copyright (c) 2023-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#define BENCH_GL
+#include "bench.hpp"
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mgl/mgl.hpp"
+
+// Every model in models/ is loaded several times over, without a mesh cache,
+// first on one thread (the serial case) and then on more. Only the import
+// time is compared; uploads always run on the calling thread.
+
+const char* MODELS[] = {"Cube.obj",           "Para.obj",
+                        "TriangleFix.obj",    "cube-v.obj",
+                        "cube-vn-flat.obj",   "cube-vn-smooth.obj",
+                        "cube-vt.obj",        "cube-vt2.obj",
+                        "cube-vtn-flat.obj"};
+const int COPIES = 16;
+
+static double loadAll(const std::string& models, unsigned int n_threads,
+                      size_t& n_assets) {
+    std::vector<std::unique_ptr<mgl::Mesh>> meshes;
+    mgl::MeshLoader loader(n_threads);
+    for (int copy = 0; copy < COPIES; copy++) {
+        for (const char* model : MODELS) {
+            meshes.emplace_back(new mgl::Mesh());
+            meshes.back()->joinIdenticalVertices();
+            meshes.back()->optimize();
+            loader.add(meshes.back().get(), models + model);
+        }
+    }
+    n_assets = meshes.size();
+    if (!loader.load()) {
+        for (const std::string& error : loader.getErrors()) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+        }
+        exit(EXIT_FAILURE);
+    }
+    return loader.getLoadTime();
+}
+
+int main(int argc, char* argv[]) {
+    const std::string models = argc > 1 ? argv[1] : "../models/";
+    GLFWwindow* window = bench::createContext(3, 3);
+
+    const unsigned int cores =
+        std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned int> threads;
+    for (unsigned int n = 1; n < cores; n *= 2) {
+        threads.push_back(n);
+    }
+    threads.push_back(cores);
+
+    std::printf("%8s %8s %12s %8s\n", "assets", "threads", "load (ms)",
+                "speedup");
+    double serial = 0.0;
+    for (const unsigned int n : threads) {
+        size_t n_assets = 0;
+        double best = 1e30;
+        for (int i = 0; i < 5; i++) {
+            best = std::min(best, loadAll(models, n, n_assets));
+        }
+        if (n == 1) {
+            serial = best;
+        }
+        std::printf("%8zu %8u %12.2f %8.2f\n", n_assets, n, best * 1e3,
+                    serial / best);
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
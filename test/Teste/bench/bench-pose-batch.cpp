@@ -0,0 +1,91 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Pose batches: scalar vs SIMD blending and composition
+//
+// Copyright (c) 2023-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "bench.hpp"
+
+#include <random>
+#include <vector>
+
+#include "mgl/mglPoseBatch.hpp"
+
+// Blends N poses between two keyframes and composes their matrices, as the
+// crab-to-cube morph does for every piece each frame. The scalar path calls
+// mgl::blend() and Pose::toMatrix() per pose; PoseBatch runs the same math
+// over SoA arrays with the instruction set it was compiled for (build with
+// -mavx2 for AVX2). The largest difference from the scalar matrices is
+// printed as a check.
+
+const size_t COUNTS[] = {1000, 10000, 100000, 1000000};
+
+static mgl::Pose randomPose(std::mt19937& random) {
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    const glm::quat rotation = glm::normalize(glm::quat(
+        uniform(random), uniform(random), uniform(random), uniform(random)));
+    return mgl::Pose(
+        glm::vec3(uniform(random), uniform(random), uniform(random)), rotation,
+        glm::vec3(1.0f + uniform(random) * 0.5f));
+}
+
+static void report(size_t count, const char* path, double seconds) {
+    std::printf("%10zu %-14s %12.1f %10.2f\n", count, path,
+                count / seconds * 1e-6, seconds * 1e3);
+}
+
+int main() {
+    std::printf("PoseBatch instruction set: %s\n",
+                mgl::PoseBatch::getInstructionSet());
+    std::printf("%10s %-14s %12s %10s\n", "nodes", "path", "Mnodes/s",
+                "time (ms)");
+    std::mt19937 random(2024);
+    for (size_t count : COUNTS) {
+        std::vector<mgl::Pose> from(count), to(count);
+        mgl::PoseBatch batch_from(count), batch_to(count), blended;
+        for (size_t i = 0; i < count; i++) {
+            from[i] = randomPose(random);
+            to[i] = randomPose(random);
+            batch_from.set(i, from[i]);
+            batch_to.set(i, to[i]);
+        }
+        std::vector<glm::mat4> scalar(count), simd(count);
+        const float t = 0.375f;
+
+        double seconds = bench::measure([&]() {
+            for (size_t i = 0; i < count; i++) {
+                scalar[i] = mgl::blend(from[i], to[i], t).toMatrix();
+            }
+        });
+        bench::keep(scalar.back()[3][0]);
+        report(count, "scalar", seconds);
+
+        seconds = bench::measure([&]() {
+            mgl::PoseBatch::blend(batch_from, batch_to, t, blended,
+                                  mgl::PoseBatch::NLERP);
+            blended.compose(simd.data());
+        });
+        bench::keep(simd.back()[3][0]);
+        report(count, "batch nlerp", seconds);
+
+        seconds = bench::measure([&]() {
+            mgl::PoseBatch::blend(batch_from, batch_to, t, blended);
+            blended.compose(simd.data());
+        });
+        bench::keep(simd.back()[3][0]);
+        report(count, "batch slerp", seconds);
+
+        float error = 0.0f;
+        for (size_t i = 0; i < count; i++) {
+            for (int c = 0; c < 4; c++) {
+                const glm::vec4 d = glm::abs(simd[i][c] - scalar[i][c]);
+                error = std::max(error, std::max(std::max(d.x, d.y),
+                                                 std::max(d.z, d.w)));
+            }
+        }
+        std::printf("%10zu %-14s %12g\n", count, "slerp max diff", error);
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Pose blending: glm::decompose per frame vs decompose-once keyframes
+//
+// Copyright (c) 2023-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include "bench.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/matrix_decompose.hpp>
+#include <random>
+#include <vector>
+
+#include "mgl/mglPose.hpp"
+
+// Blends the crab and cube keyframes of many nodes to a new progress every
+// frame. The old path is SceneNode::interpolateMatrix: decompose both
+// matrices, mix/slerp/mix, then multiply translate, rotate and scale
+// matrices. The new path decomposes the keyframes into Poses once and only
+// blends and composes per frame. The largest difference between the two
+// results is printed as a check.
+
+const size_t NODES = 4096;
+
+static glm::mat4 interpolateMatrix(const glm::mat4& CrabMat,
+                                   const glm::mat4& CubeMat, float progress) {
+    glm::vec3 startTranslation, endTranslation, startScale, endScale,
+        startSkew, endSkew;
+    glm::vec4 startPerspective, endPerspective;
+    glm::quat startRotation, endRotation;
+    glm::decompose(CrabMat, startScale, startRotation, startTranslation,
+                   startSkew, startPerspective);
+    glm::decompose(CubeMat, endScale, endRotation, endTranslation, endSkew,
+                   endPerspective);
+    const glm::vec3 translation =
+        glm::mix(startTranslation, endTranslation, progress);
+    const glm::quat rotation = glm::slerp(startRotation, endRotation, progress);
+    const glm::vec3 scale = glm::mix(startScale, endScale, progress);
+    return glm::translate(glm::mat4(1.0f), translation) *
+           glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+}
+
+static glm::mat4 randomMatrix(std::mt19937& random) {
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    const glm::vec3 translation(uniform(random), uniform(random),
+                                uniform(random));
+    const glm::vec3 axis = glm::normalize(
+        glm::vec3(uniform(random), uniform(random), uniform(random)) +
+        glm::vec3(0.0f, 0.0f, 2.0f));
+    const glm::vec3 scale(1.5f + uniform(random) * 0.5f);
+    return glm::translate(glm::mat4(1.0f), translation) *
+           glm::rotate(glm::mat4(1.0f), uniform(random) * 3.0f, axis) *
+           glm::scale(glm::mat4(1.0f), scale);
+}
+
+int main() {
+    std::mt19937 random(2024);
+    std::vector<glm::mat4> crab(NODES), cube(NODES), result(NODES);
+    for (size_t i = 0; i < NODES; i++) {
+        crab[i] = randomMatrix(random);
+        cube[i] = randomMatrix(random);
+    }
+
+    float progress = 0.0f;
+    const double decompose = bench::measure([&]() {
+        progress = progress < 1.0f ? progress + 0.01f : 0.0f;
+        for (size_t i = 0; i < NODES; i++) {
+            result[i] = interpolateMatrix(crab[i], cube[i], progress);
+        }
+    });
+    bench::keep(result.back()[3][0]);
+    std::vector<glm::mat4> expected(NODES);
+    for (size_t i = 0; i < NODES; i++) {
+        expected[i] = interpolateMatrix(crab[i], cube[i], 0.5f);
+    }
+
+    std::vector<mgl::Pose> from(NODES), to(NODES);
+    const double setup = bench::measure([&]() {
+        for (size_t i = 0; i < NODES; i++) {
+            from[i] = mgl::Pose::fromMatrix(crab[i]);
+            to[i] = mgl::Pose::fromMatrix(cube[i]);
+        }
+    });
+    const double pose = bench::measure([&]() {
+        progress = progress < 1.0f ? progress + 0.01f : 0.0f;
+        for (size_t i = 0; i < NODES; i++) {
+            result[i] = mgl::blend(from[i], to[i], progress).toMatrix();
+        }
+    });
+    bench::keep(result.back()[3][0]);
+
+    float error = 0.0f;
+    for (size_t i = 0; i < NODES; i++) {
+        const glm::mat4 m = mgl::blend(from[i], to[i], 0.5f).toMatrix();
+        for (int c = 0; c < 4; c++) {
+            const glm::vec4 d = glm::abs(m[c] - expected[i][c]);
+            error = std::max(error, std::max(std::max(d.x, d.y),
+                                             std::max(d.z, d.w)));
+        }
+    }
+
+    std::printf("%-22s %12s\n", "path", "ns/node");
+    std::printf("%-22s %12.1f\n", "decompose per frame",
+                decompose / NODES * 1e9);
+    std::printf("%-22s %12.1f\n", "pose blend", pose / NODES * 1e9);
+    std::printf("%-22s %12.1f\n", "pose setup (once)", setup / NODES * 1e9);
+    std::printf("speedup %.1fx, max difference %g\n", decompose / pose, error);
+    return 0;
+}
@@ -0,0 +1,85 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Program binary cache: startup time with the cache off, cold and warm
+//
+// Copyright (c) 2023-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#define BENCH_GL
+#include "bench.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mgl/mgl.hpp"
+
+// Creates dozens of programs, the shipped shader pairs each with several
+// defines, as an application with many materials would at startup. They are
+// created three times: without a cache directory, with an empty cache (which
+// compiles and saves the binaries) and with the cache filled. Every run adds
+// a define of its own so that neither this cache nor the driver's shader
+// cache has seen the sources before. The binaries are left in bench-cache,
+// which "make clean" removes.
+
+const char* CACHE = "bench-cache";
+const int VARIANTS = 16;
+
+const struct {
+    const char* vertex;
+    const char* fragment;
+} PAIRS[] = {{"../cube-vs.glsl", "../cube-fs.glsl"},
+             {"../cube-instanced-vs.glsl", "../cube-instanced-fs.glsl"},
+             {"../clip-vs.glsl", "../clip-fs.glsl"}};
+
+// Seconds to create every program, and how many came from the cache.
+static double createPrograms(const std::string& run, const char* cache,
+                             size_t& from_cache) {
+    std::vector<std::unique_ptr<mgl::ShaderProgram>> programs;
+    from_cache = 0;
+    const bench::clock::time_point start = bench::clock::now();
+    for (const auto& pair : PAIRS) {
+        for (int v = 0; v < VARIANTS; v++) {
+            std::unique_ptr<mgl::ShaderProgram> program(
+                new mgl::ShaderProgram());
+            if (cache) {
+                program->setCacheDirectory(cache);
+            }
+            program->addDefine("BENCH_RUN " + run);
+            program->addDefine("BENCH_VARIANT " + std::to_string(v));
+            program->addShader(GL_VERTEX_SHADER, pair.vertex);
+            program->addShader(GL_FRAGMENT_SHADER, pair.fragment);
+            program->create();
+            from_cache += program->isFromCache() ? 1 : 0;
+            programs.push_back(std::move(program));
+        }
+    }
+    return std::chrono::duration<double>(bench::clock::now() - start).count();
+}
+
+static void report(const char* cache, double seconds, size_t from_cache) {
+    const size_t count = sizeof(PAIRS) / sizeof(PAIRS[0]) * VARIANTS;
+    std::printf("%-12s %10zu %12.1f %12.2f %12zu\n", cache, count,
+                seconds * 1e3, seconds / count * 1e3, from_cache);
+}
+
+int main() {
+    GLFWwindow* window = bench::createContext(4, 1);
+    const std::string run = std::to_string(
+        bench::clock::now().time_since_epoch().count());
+
+    std::printf("%-12s %10s %12s %12s %12s\n", "cache", "programs",
+                "total (ms)", "ms/program", "from cache");
+    size_t from_cache = 0;
+    double seconds = createPrograms(run + "0", nullptr, from_cache);
+    report("off", seconds, from_cache);
+    seconds = createPrograms(run + "1", CACHE, from_cache);
+    report("cold", seconds, from_cache);
+    seconds = createPrograms(run + "1", CACHE, from_cache);
+    report("warm", seconds, from_cache);
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
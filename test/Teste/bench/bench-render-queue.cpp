@@ -0,0 +1,109 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Render queue: state changes and sort time per frame
+//
+// Copyright (c) 2023-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "bench.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "mgl/mglRenderQueue.hpp"
+
+// A scene of many draws spread over 64 programs, 8 vertex arrays and 512
+// meshes, a tenth of them transparent, at random depths. Each frame builds
+// the keys and orders the draws in three ways: as traversed (no sort), with
+// std::sort on the packets, and with RenderQueue's radix sort. The program,
+// vertex array and mesh changes of the resulting order are counted as a
+// renderer submitting in that order would see them.
+
+const size_t COUNTS[] = {1000, 10000, 100000};
+const uint32_t PROGRAMS = 64, VAOS = 8, MESHES = 512;
+
+struct Draw {
+    uint32_t program, vao, mesh;
+    bool transparent;
+    float depth;
+};
+
+struct Changes {
+    size_t program = 0, vao = 0, mesh = 0;
+};
+
+static Changes countChanges(const std::vector<Draw>& draws,
+                            const std::vector<mgl::DrawPacket>& order) {
+    Changes changes;
+    const Draw* previous = nullptr;
+    for (const mgl::DrawPacket& packet : order) {
+        const Draw& draw = draws[packet.index];
+        if (!previous || previous->program != draw.program) changes.program++;
+        if (!previous || previous->vao != draw.vao) changes.vao++;
+        if (!previous || previous->mesh != draw.mesh) changes.mesh++;
+        previous = &draw;
+    }
+    return changes;
+}
+
+static void report(size_t count, const char* order, double seconds,
+                   const Changes& changes) {
+    std::printf("%8zu %-10s %10.3f %10zu %10zu %10zu\n", count, order,
+                seconds * 1e3, changes.program, changes.vao, changes.mesh);
+}
+
+int main() {
+    std::printf("%8s %-10s %10s %10s %10s %10s\n", "draws", "order",
+                "cpu (ms)", "programs", "vaos", "meshes");
+    std::mt19937 random(2024);
+    for (size_t count : COUNTS) {
+        std::vector<Draw> draws(count);
+        std::uniform_int_distribution<uint32_t> program(0, PROGRAMS - 1);
+        std::uniform_int_distribution<uint32_t> mesh(0, MESHES - 1);
+        std::uniform_real_distribution<float> depth(1.0f, 100.0f);
+        for (Draw& draw : draws) {
+            draw.program = program(random);
+            draw.mesh = mesh(random);
+            draw.vao = draw.mesh % VAOS;
+            draw.transparent = random() % 10 == 0;
+            draw.depth = depth(random);
+        }
+
+        mgl::RenderQueue queue;
+        auto build = [&]() {
+            queue.clear();
+            for (size_t i = 0; i < count; i++) {
+                const Draw& d = draws[i];
+                queue.push(mgl::RenderQueue::makeKey(0, d.transparent,
+                                                     d.program, 0, d.vao,
+                                                     d.mesh, d.depth),
+                           static_cast<uint32_t>(i));
+            }
+        };
+
+        double seconds = bench::measure(build);
+        report(count, "traversal", seconds,
+               countChanges(draws, queue.getPackets()));
+
+        std::vector<mgl::DrawPacket> packets;
+        seconds = bench::measure([&]() {
+            build();
+            packets = queue.getPackets();
+            std::sort(packets.begin(), packets.end(),
+                      [](const mgl::DrawPacket& a, const mgl::DrawPacket& b) {
+                          return a.key < b.key;
+                      });
+        });
+        report(count, "std::sort", seconds, countChanges(draws, packets));
+
+        seconds = bench::measure([&]() {
+            build();
+            queue.sort();
+        });
+        report(count, "radix", seconds,
+               countChanges(draws, queue.getPackets()));
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Scene graph: world transform update, recursive nodes vs flat arrays
+//
+// Copyright (c) 2023-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "bench.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <memory>
+#include <vector>
+
+#include "mgl/mglScenegraph.hpp"
+
+// Each frame rotates every node and recomputes all world matrices. The
+// recursive baseline keeps a translation, rotation and scale matrix and a
+// vector of children per heap-allocated node, like the old SceneNode, and
+// multiplies down the tree from the root. SceneGraph stores the nodes in
+// topological order and updates them in one linear pass. A frame where no
+// node moved is timed as well. The hierarchy is a forest of chains, so depth
+// varies while the node count stays the same.
+
+const size_t NODES = 1 << 17;
+const size_t DEPTHS[] = {1, 4, 16, 256};
+
+struct RecursiveNode {
+    glm::mat4 TranslateMatrix = glm::mat4(1.0f);
+    glm::mat4 RotateMatrix = glm::mat4(1.0f);
+    glm::mat4 ScaleMatrix = glm::mat4(1.0f);
+    glm::mat4 WorldMatrix = glm::mat4(1.0f);
+    std::vector<RecursiveNode*> children;
+
+    void update(const glm::mat4& parent) {
+        WorldMatrix = parent * TranslateMatrix * RotateMatrix * ScaleMatrix;
+        for (RecursiveNode* child : children) {
+            child->update(WorldMatrix);
+        }
+    }
+};
+
+static void report(size_t depth, const char* path, double seconds) {
+    std::printf("%6zu %-16s %10.1f %12.1f\n", depth, path, seconds * 1e6,
+                NODES / seconds * 1e-6);
+}
+
+int main() {
+    std::printf("%6s %-16s %10s %12s\n", "depth", "update", "time (us)",
+                "Mnodes/s");
+    for (size_t depth : DEPTHS) {
+        const glm::vec3 offset(0.0f, 1.0f, 0.0f);
+        float angle = 0.0f;
+
+        std::vector<std::unique_ptr<RecursiveNode>> nodes;
+        std::vector<RecursiveNode*> roots;
+        for (size_t i = 0; i < NODES; i++) {
+            nodes.emplace_back(new RecursiveNode());
+            nodes[i]->TranslateMatrix = glm::translate(glm::mat4(1.0f), offset);
+            if (i % depth == 0) {
+                roots.push_back(nodes[i].get());
+            } else {
+                nodes[i - 1]->children.push_back(nodes[i].get());
+            }
+        }
+        double seconds = bench::measure([&]() {
+            angle += 0.01f;
+            const glm::mat4 rotation =
+                glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0, 0, 1));
+            for (const std::unique_ptr<RecursiveNode>& node : nodes) {
+                node->RotateMatrix = rotation;
+            }
+            for (RecursiveNode* root : roots) {
+                root->update(glm::mat4(1.0f));
+            }
+        });
+        bench::keep(nodes.back()->WorldMatrix[3][1]);
+        report(depth, "recursive", seconds);
+
+        mgl::SceneGraph graph;
+        graph.reserve(NODES);
+        for (size_t i = 0; i < NODES; i++) {
+            const mgl::NodeId node = graph.addNode(
+                i % depth == 0 ? mgl::NO_PARENT
+                               : static_cast<mgl::NodeId>(i - 1));
+            graph.setTranslation(node, offset);
+        }
+        graph.updateWorld();
+        seconds = bench::measure([&]() {
+            angle += 0.01f;
+            const glm::quat rotation =
+                glm::angleAxis(angle, glm::vec3(0, 0, 1));
+            for (size_t i = 0; i < NODES; i++) {
+                graph.setRotation(static_cast<mgl::NodeId>(i), rotation);
+            }
+            graph.updateWorld();
+        });
+        bench::keep(graph.getWorldMatrix(NODES - 1)[3][1]);
+        report(depth, "flat", seconds);
+
+        // Nothing is dirty, so no node is visited.
+        seconds = bench::measure([&]() { graph.updateWorld(); });
+        std::printf("%6zu %-16s %10.1f %12s\n", depth, "flat (static)",
+                    seconds * 1e6, "-");
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Benchmark Helpers
+//
+// Copyright (c) 2023-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+// Benchmarks print one line per measurement and take the best of a few runs,
+// which is the least disturbed by the rest of the system.
+
+namespace bench {
+
+typedef std::chrono::steady_clock clock;
+
+// Best time of run() in seconds.
+template <typename F> double measure(F run, int repeats = 5) {
+    double best = 1e30;
+    for (int i = 0; i < repeats; i++) {
+        const clock::time_point start = clock::now();
+        run();
+        const double seconds =
+            std::chrono::duration<double>(clock::now() - start).count();
+        best = std::min(best, seconds);
+    }
+    return best;
+}
+
+// Keeps the compiler from optimizing away a result.
+template <typename T> void keep(const T& value) {
+    static volatile char sink;
+    sink = *reinterpret_cast<const volatile char*>(&value);
+    (void)sink;
+}
+
+} // namespace bench
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef BENCH_GL
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <cstdlib>
+
+namespace bench {
+
+// Hidden window with a current context; exits when the version is missing.
+inline GLFWwindow* createContext(int major = 4, int minor = 6) {
+    if (!glfwInit()) {
+        exit(EXIT_FAILURE);
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, major);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minor);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(640, 480, "bench", nullptr, nullptr);
+    if (!window) {
+        std::fprintf(stderr, "OpenGL %d.%d is not available\n", major, minor);
+        glfwTerminate();
+        exit(EXIT_FAILURE);
+    }
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+    glewExperimental = GL_TRUE;
+    if (glewInit() != GLEW_OK) {
+        exit(EXIT_FAILURE);
+    }
+    glGetError();
+    return window;
+}
+
+// GPU time of draw() in seconds, measured with a timer query.
+template <typename F> double measureGpu(F draw) {
+    GLuint query;
+    glGenQueries(1, &query);
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    draw();
+    glEndQuery(GL_TIME_ELAPSED);
+    GLuint64 nanoseconds = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+    glDeleteQueries(1, &query);
+    return nanoseconds * 1e-9;
+}
+
+} // namespace bench
+
+#endif /* BENCH_GL */
+
+#endif /* BENCH_HPP */
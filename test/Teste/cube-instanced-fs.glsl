@@ -0,0 +1,18 @@
+#version 330 core
+
+in vec3 exPosition;
+in vec2 exTexcoord;
+in vec3 exNormal;
+flat in vec3 exColor;
+
+out vec4 FragmentColor;
+
+void main(void)
+{
+    vec3 N = normalize(exNormal);
+    vec3 color;
+
+    vec3 colorVariation = N * 0.1 + 0.6;
+    color = exColor * colorVariation;
+    FragmentColor = vec4(color, 1.0);
+}
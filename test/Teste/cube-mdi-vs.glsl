@@ -0,0 +1,70 @@
+#version 430 core
+#extension GL_ARB_shader_draw_parameters : require
+
+in vec3 inPosition;
+in vec2 inTexcoord;
+in vec3 inNormal;
+
+out vec3 exPosition;
+out vec2 exTexcoord;
+out vec3 exNormal;
+flat out vec3 exColor;
+
+// Per-draw data written by mgl::IndirectRenderer (DRAW_DATA_BINDING),
+// with the mesh's vertex decode (mglConventions.hpp).
+struct DrawData {
+   mat4 ModelMatrix;
+   vec4 Color;
+   vec4 PositionScale; // w: decode flags
+   vec4 PositionBias;
+   vec4 TexcoordDecode; // scale in xy, bias in zw
+};
+
+layout(std430, binding = 0) readonly buffer DrawDataBlock {
+   DrawData Draws[];
+};
+
+uniform Camera {
+   mat4 ViewMatrix;
+   mat4 ProjectionMatrix;
+};
+
+const int DECODE_POSITION = 1;
+const int DECODE_TEXCOORD = 2;
+const int DECODE_OCTAHEDRAL = 4;
+
+vec3 decodeOctahedral(vec2 e)
+{
+	vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (v.z < 0.0) {
+		v.xy = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(v);
+}
+
+void main(void)
+{
+	DrawData draw = Draws[gl_BaseInstanceARB + gl_InstanceID];
+
+	int decode = int(draw.PositionScale.w);
+	vec3 position = inPosition;
+	vec2 texcoord = inTexcoord;
+	vec3 normal = inNormal;
+	if ((decode & DECODE_POSITION) != 0) {
+		position = position * draw.PositionScale.xyz + draw.PositionBias.xyz;
+	}
+	if ((decode & DECODE_TEXCOORD) != 0) {
+		texcoord = texcoord * draw.TexcoordDecode.xy + draw.TexcoordDecode.zw;
+	}
+	if ((decode & DECODE_OCTAHEDRAL) != 0) {
+		normal = decodeOctahedral(inNormal.xy);
+	}
+
+	exPosition = position;
+	exTexcoord = texcoord;
+	exNormal = normal;
+	exColor = draw.Color.rgb;
+
+	vec4 MCPosition = vec4(position, 1.0);
+	gl_Position = ProjectionMatrix * ViewMatrix * draw.ModelMatrix * MCPosition;
+}
@@ -15,12 +15,45 @@ uniform Camera {
    mat4 ProjectionMatrix;
 };
 
+// Quantized attributes (mglConventions.hpp); all zero for float meshes.
+uniform int VertexDecode;
+uniform vec3 PositionScale;
+uniform vec3 PositionBias;
+uniform vec2 TexcoordScale;
+uniform vec2 TexcoordBias;
+
+const int DECODE_POSITION = 1;
+const int DECODE_TEXCOORD = 2;
+const int DECODE_OCTAHEDRAL = 4;
+
+vec3 decodeOctahedral(vec2 e)
+{
+	vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (v.z < 0.0) {
+		v.xy = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(v);
+}
+
 void main(void)
 {
-	exPosition = inPosition;
-	exTexcoord = inTexcoord;
-	exNormal = inNormal;
+	vec3 position = inPosition;
+	vec2 texcoord = inTexcoord;
+	vec3 normal = inNormal;
+	if ((VertexDecode & DECODE_POSITION) != 0) {
+		position = position * PositionScale + PositionBias;
+	}
+	if ((VertexDecode & DECODE_TEXCOORD) != 0) {
+		texcoord = texcoord * TexcoordScale + TexcoordBias;
+	}
+	if ((VertexDecode & DECODE_OCTAHEDRAL) != 0) {
+		normal = decodeOctahedral(inNormal.xy);
+	}
+
+	exPosition = position;
+	exTexcoord = texcoord;
+	exNormal = normal;
 
-	vec4 MCPosition = vec4(inPosition, 1.0);
+	vec4 MCPosition = vec4(position, 1.0);
 	gl_Position = ProjectionMatrix * ViewMatrix * ModelMatrix * MCPosition;
 }
@@ -12,12 +12,27 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
-#include "./mglApp.hpp"          // IWYU pragma: keep
-#include "./mglCamera.hpp"       // IWYU pragma: keep
-#include "./mglConventions.hpp"  // IWYU pragma: keep
-#include "./mglError.hpp"        // IWYU pragma: keep
-#include "./mglMesh.hpp"         // IWYU pragma: keep
-#include "./mglScenegraph.hpp"   // IWYU pragma: keep
-#include "./mglShader.hpp"       // IWYU pragma: keep
+#include "./mglAnimation.hpp"         // IWYU pragma: keep
+#include "./mglApp.hpp"               // IWYU pragma: keep
+#include "./mglBounds.hpp"            // IWYU pragma: keep
+#include "./mglBvh.hpp"               // IWYU pragma: keep
+#include "./mglCamera.hpp"            // IWYU pragma: keep
+#include "./mglConventions.hpp"       // IWYU pragma: keep
+#include "./mglError.hpp"             // IWYU pragma: keep
+#include "./mglIndirectRenderer.hpp"  // IWYU pragma: keep
+#include "./mglInstancing.hpp"        // IWYU pragma: keep
+#include "./mglMesh.hpp"              // IWYU pragma: keep
+#include "./mglMeshArena.hpp"         // IWYU pragma: keep
+#include "./mglMeshLoader.hpp"        // IWYU pragma: keep
+#include "./mglMeshOptimizer.hpp"     // IWYU pragma: keep
+#include "./mglOcclusion.hpp"         // IWYU pragma: keep
+#include "./mglPose.hpp"              // IWYU pragma: keep
+#include "./mglPoseBatch.hpp"         // IWYU pragma: keep
+#include "./mglRenderQueue.hpp"       // IWYU pragma: keep
+#include "./mglScenegraph.hpp"        // IWYU pragma: keep
+#include "./mglShader.hpp"            // IWYU pragma: keep
+#include "./mglShaderLibrary.hpp"     // IWYU pragma: keep
+#include "./mglState.hpp"             // IWYU pragma: keep
+#include "./mglStreamBuffer.hpp"      // IWYU pragma: keep
 
 #endif /* MGL_HPP */
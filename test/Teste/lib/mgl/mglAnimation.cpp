@@ -0,0 +1,262 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Keyframe Animation (clips, channels and playback)
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglAnimation.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace mgl {
+
+///////////////////////////////////////////////////////////////////////// Easing
+
+float ease(Easing easing, float t) {
+  switch (easing) {
+  case EASE_IN:
+    return t * t;
+  case EASE_OUT:
+    return t * (2.0f - t);
+  case EASE_IN_OUT:
+    return t * t * (3.0f - 2.0f * t);
+  case STEP:
+    return t < 1.0f ? 0.0f : 1.0f;
+  default:
+    return t;
+  }
+}
+
+////////////////////////////////////////////////////////////////// AnimationClip
+
+AnimationClip::AnimationClip(const std::string &name)
+    : Name(name), Duration(0.0f) {}
+
+const std::string &AnimationClip::getName() const { return Name; }
+
+float AnimationClip::getDuration() const { return Duration; }
+
+size_t AnimationClip::addChannel(NodeId node, Target target, Easing easing) {
+  Channels.push_back({node, target, easing, {}, {}, 0});
+  return Channels.size() - 1;
+}
+
+void AnimationClip::addKey(size_t channel, float time,
+                           const glm::vec4 &value) {
+  Channel &c = Channels[channel];
+  const size_t i =
+      std::upper_bound(c.times.begin(), c.times.end(), time) - c.times.begin();
+  c.times.insert(c.times.begin() + i, time);
+  c.values.insert(c.values.begin() + i, value);
+  Duration = std::max(Duration, time);
+}
+
+void AnimationClip::addKey(size_t channel, float time,
+                           const glm::vec3 &value) {
+  addKey(channel, time, glm::vec4(value, 0.0f));
+}
+
+void AnimationClip::addKey(size_t channel, float time,
+                           const glm::quat &value) {
+  addKey(channel, time, glm::vec4(value.x, value.y, value.z, value.w));
+}
+
+void AnimationClip::addPoseKeys(NodeId node, const std::vector<float> &times,
+                                const std::vector<Pose> &poses,
+                                Easing easing) {
+  const size_t t = addChannel(node, TRANSLATION, easing);
+  const size_t r = addChannel(node, ROTATION, easing);
+  const size_t s = addChannel(node, SCALE, easing);
+  for (size_t i = 0; i < times.size() && i < poses.size(); i++) {
+    addKey(t, times[i], poses[i].translation);
+    addKey(r, times[i], poses[i].rotation);
+    addKey(s, times[i], poses[i].scale);
+  }
+}
+
+// Starts from the segment of the previous sample, which for continuous
+// playback is the right one or a neighbour.
+size_t AnimationClip::findSegment(Channel &channel, float time) {
+  const size_t last = channel.times.size() - 2;
+  size_t i = std::min(channel.cursor, last);
+  while (i < last && time >= channel.times[i + 1]) {
+    i++;
+  }
+  while (i > 0 && time < channel.times[i]) {
+    i--;
+  }
+  channel.cursor = i;
+  return i;
+}
+
+// First batch component and number of components animated by a target.
+static PoseBatch::Component firstComponent(AnimationClip::Target target) {
+  switch (target) {
+  case AnimationClip::TRANSLATION:
+    return PoseBatch::TX;
+  case AnimationClip::ROTATION:
+    return PoseBatch::RX;
+  default:
+    return PoseBatch::SX;
+  }
+}
+
+static int componentCount(AnimationClip::Target target) {
+  return target == AnimationClip::ROTATION ? 4 : 3;
+}
+
+void AnimationClip::sample(float time, SceneGraph &graph) {
+  // Entries added by resize() are identity poses, so the components a
+  // channel does not animate blend to themselves.
+  From.resize(Channels.size());
+  To.resize(Channels.size());
+  Weights.resize(Channels.size());
+  for (size_t k = 0; k < Channels.size(); k++) {
+    Channel &c = Channels[k];
+    if (c.times.empty()) {
+      continue;
+    }
+    size_t i = 0, j = 0;
+    float u = 0.0f;
+    if (c.times.size() > 1) {
+      i = findSegment(c, time);
+      j = i + 1;
+      const float t0 = c.times[i], t1 = c.times[j];
+      u = ease(c.easing,
+               t1 > t0 ? glm::clamp((time - t0) / (t1 - t0), 0.0f, 1.0f)
+                       : 1.0f);
+    }
+    const PoseBatch::Component first = firstComponent(c.target);
+    for (int e = 0; e < componentCount(c.target); e++) {
+      const PoseBatch::Component component =
+          static_cast<PoseBatch::Component>(first + e);
+      From.data(component)[k] = c.values[i][e];
+      To.data(component)[k] = c.values[j][e];
+    }
+    Weights[k] = u;
+  }
+  PoseBatch::blend(From, To, Weights.data(), Blended);
+
+  for (size_t k = 0; k < Channels.size(); k++) {
+    const Channel &c = Channels[k];
+    if (c.times.empty()) {
+      continue;
+    }
+    glm::vec4 value(0.0f);
+    const PoseBatch::Component first = firstComponent(c.target);
+    for (int e = 0; e < componentCount(c.target); e++) {
+      value[e] = Blended.data(static_cast<PoseBatch::Component>(first + e))[k];
+    }
+    switch (c.target) {
+    case TRANSLATION:
+      graph.setTranslation(c.node, glm::vec3(value));
+      break;
+    case ROTATION:
+      graph.setRotation(c.node, glm::quat(value.w, value.x, value.y, value.z));
+      break;
+    case SCALE:
+      graph.setScale(c.node, glm::vec3(value));
+      break;
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////////////// Animator
+
+Animator::Animator()
+    : Clip(nullptr), Time(0.0f), Speed(1.0f), Playing(false), Reversed(false),
+      Looping(false), Sampled(false) {}
+
+Animator::~Animator() {
+  for (auto &clip : Clips) {
+    delete clip.second;
+  }
+}
+
+void Animator::addClip(AnimationClip *clip) {
+  AnimationClip *&slot = Clips[clip->getName()];
+  if (slot != nullptr && slot != clip) {
+    delete slot;
+  }
+  slot = clip;
+}
+
+AnimationClip *Animator::getClip(const std::string &name) const {
+  auto it = Clips.find(name);
+  return it == Clips.end() ? nullptr : it->second;
+}
+
+void Animator::setClip(const std::string &name) {
+  AnimationClip *clip = getClip(name);
+  if (clip == nullptr) {
+    std::cerr << "[ERROR] Animation clip " << name << " not found"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  Clip = clip;
+  Time = 0.0f;
+  Playing = false;
+  Sampled = false;
+}
+
+void Animator::play() {
+  Playing = true;
+  Reversed = false;
+}
+
+void Animator::reverse() {
+  Playing = true;
+  Reversed = true;
+}
+
+void Animator::pause() { Playing = false; }
+
+void Animator::seek(float time) {
+  Time = Clip ? glm::clamp(time, 0.0f, Clip->getDuration()) : 0.0f;
+  Sampled = false;
+}
+
+void Animator::setSpeed(float speed) { Speed = speed; }
+
+void Animator::setLooping(bool looping) { Looping = looping; }
+
+bool Animator::isPlaying() const { return Playing; }
+
+bool Animator::isReversed() const { return Reversed; }
+
+float Animator::getTime() const { return Time; }
+
+void Animator::update(double elapsed, SceneGraph &graph) {
+  if (Clip == nullptr) {
+    return;
+  }
+  if (Playing) {
+    const float duration = Clip->getDuration();
+    Time += static_cast<float>(elapsed) * Speed * (Reversed ? -1.0f : 1.0f);
+    if (Looping && duration > 0.0f) {
+      Time = std::fmod(Time, duration);
+      if (Time < 0.0f) Time += duration;
+    } else {
+      // Only the end playback is heading to stops it, so that play() from
+      // the start or a zero speed does not.
+      const bool ended = Reversed ? Time <= 0.0f : Time >= duration;
+      Time = glm::clamp(Time, 0.0f, duration);
+      if (ended) {
+        Playing = false;
+      }
+    }
+    Sampled = false;
+  }
+  // A paused animator leaves the nodes alone.
+  if (!Sampled) {
+    Clip->sample(Time, graph);
+    Sampled = true;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}  // namespace mgl
@@ -0,0 +1,116 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Keyframe Animation (clips, channels and playback)
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_ANIMATION_HPP
+#define MGL_ANIMATION_HPP
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "./mglPoseBatch.hpp"
+#include "./mglScenegraph.hpp"
+
+namespace mgl {
+
+class AnimationClip;
+class Animator;
+
+///////////////////////////////////////////////////////////////////////// Easing
+
+enum Easing { LINEAR, EASE_IN, EASE_OUT, EASE_IN_OUT, STEP };
+
+float ease(Easing easing, float t);
+
+////////////////////////////////////////////////////////////////// AnimationClip
+
+// A named set of channels, each animating the translation, rotation or scale
+// of one scene node through keyframes sorted by time (in seconds). The easing
+// of a channel shapes every segment between two of its keys. Each channel
+// remembers the segment it last sampled, so playback in either direction
+// costs constant time per channel per frame. The keys around the sampled
+// time of every channel are blended together in one PoseBatch, with one
+// pose per channel of which only the animated component is used.
+
+class AnimationClip {
+ public:
+  enum Target { TRANSLATION, ROTATION, SCALE };
+
+  explicit AnimationClip(const std::string &name);
+  const std::string &getName() const;
+  float getDuration() const;
+
+  size_t addChannel(NodeId node, Target target, Easing easing = LINEAR);
+  void addKey(size_t channel, float time, const glm::vec3 &value);
+  void addKey(size_t channel, float time, const glm::quat &value);
+  // Adds translation, rotation and scale channels keyed with the poses.
+  void addPoseKeys(NodeId node, const std::vector<float> &times,
+                   const std::vector<Pose> &poses, Easing easing = LINEAR);
+
+  void sample(float time, SceneGraph &graph);
+
+ private:
+  struct Channel {
+    NodeId node;
+    Target target;
+    Easing easing;
+    std::vector<float> times;
+    std::vector<glm::vec4> values;  // vec3 in xyz, or quaternion xyzw
+    size_t cursor;
+  };
+  std::string Name;
+  std::vector<Channel> Channels;
+  float Duration;
+  PoseBatch From, To, Blended;
+  std::vector<float> Weights;
+
+  void addKey(size_t channel, float time, const glm::vec4 &value);
+  static size_t findSegment(Channel &channel, float time);
+};
+
+/////////////////////////////////////////////////////////////////////// Animator
+
+// Plays one clip at a time from the elapsed time of each frame. Reversing
+// plays backwards from the current time; a clip that is not looping stops
+// at either end.
+
+class Animator {
+ public:
+  Animator();
+  ~Animator();
+
+  void addClip(AnimationClip *clip);  // takes ownership
+  AnimationClip *getClip(const std::string &name) const;
+  void setClip(const std::string &name);
+
+  void play();
+  void reverse();
+  void pause();
+  void seek(float time);
+  void setSpeed(float speed);
+  void setLooping(bool looping);
+
+  bool isPlaying() const;
+  bool isReversed() const;
+  float getTime() const;
+
+  void update(double elapsed, SceneGraph &graph);
+
+ private:
+  std::map<std::string, AnimationClip *> Clips;
+  AnimationClip *Clip;
+  float Time, Speed;
+  bool Playing, Reversed, Looping, Sampled;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}  // namespace mgl
+
+#endif /* MGL_ANIMATION_HPP */
@@ -11,6 +11,7 @@
 #include <iostream>
 
 #include "./mglError.hpp" // IWYU pragma: keep -- required in debug mode
+#include "./mglState.hpp"
 
 namespace mgl {
 
@@ -142,13 +143,15 @@ void Engine::setupGLEW() {
 
 void Engine::setupOpenGL() {
   glClearColor(0.1f, 0.1f, 0.3f, 1.0f);
-  glEnable(GL_DEPTH_TEST);
+  State &state = State::getInstance();
+  state.enable(GL_DEPTH_TEST);
   glDepthFunc(GL_LEQUAL);
   glDepthMask(GL_TRUE);
   glDepthRange(0.0, 1.0);
   glClearDepth(1.0);
-  glEnable(GL_CULL_FACE);
+  state.enable(GL_CULL_FACE);
   glCullFace(GL_BACK);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);  // transparent draws
   glFrontFace(GL_CCW);
   glViewport(0, 0, WindowWidth, WindowHeight);
 }
@@ -185,6 +188,7 @@ void Engine::run() {
     last_time = time;
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
     GlApp->displayCallback(Window, elapsed_time);
+    State::getInstance().endFrame();
     glfwSwapBuffers(Window);
     glfwPollEvents();
   }
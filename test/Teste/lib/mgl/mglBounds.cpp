@@ -0,0 +1,305 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Bounding Volumes and Frustum Culling
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglBounds.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+#include "./mglSimd.hpp"
+
+namespace mgl {
+
+//////////////////////////////////////////////////////////////////// BoundingBox
+
+BoundingBox::BoundingBox() : min(FLT_MAX), max(-FLT_MAX) {}
+
+BoundingBox::BoundingBox(const glm::vec3 &min, const glm::vec3 &max)
+    : min(min), max(max) {}
+
+BoundingBox BoundingBox::fromPoints(const glm::vec3 *points,
+                                    size_t n_points) {
+  BoundingBox box;
+  for (size_t i = 0; i < n_points; i++) {
+    box.add(points[i]);
+  }
+  return box;
+}
+
+bool BoundingBox::isEmpty() const {
+  return min.x > max.x || min.y > max.y || min.z > max.z;
+}
+
+void BoundingBox::add(const glm::vec3 &point) {
+  min = glm::min(min, point);
+  max = glm::max(max, point);
+}
+
+void BoundingBox::add(const BoundingBox &box) {
+  min = glm::min(min, box.min);
+  max = glm::max(max, box.max);
+}
+
+bool BoundingBox::overlaps(const BoundingBox &box) const {
+  return min.x <= box.max.x && box.min.x <= max.x && min.y <= box.max.y &&
+         box.min.y <= max.y && min.z <= box.max.z && box.min.z <= max.z;
+}
+
+glm::vec3 BoundingBox::getCenter() const { return (min + max) * 0.5f; }
+
+glm::vec3 BoundingBox::getExtent() const { return (max - min) * 0.5f; }
+
+BoundingBox BoundingBox::transform(const glm::mat4 &matrix) const {
+  if (isEmpty()) {
+    return *this;
+  }
+  const glm::vec3 center = glm::vec3(matrix * glm::vec4(getCenter(), 1.0f));
+  const glm::vec3 extent = getExtent();
+  glm::vec3 new_extent(0.0f);
+  for (int col = 0; col < 3; col++) {
+    new_extent += glm::abs(glm::vec3(matrix[col])) * extent[col];
+  }
+  return BoundingBox(center - new_extent, center + new_extent);
+}
+
+///////////////////////////////////////////////////////////////// BoundingSphere
+
+BoundingSphere::BoundingSphere() : center(0.0f), radius(-1.0f) {}
+
+BoundingSphere::BoundingSphere(const glm::vec3 &center, float radius)
+    : center(center), radius(radius) {}
+
+static size_t farthest(const glm::vec3 *points, size_t n_points,
+                       const glm::vec3 &from) {
+  size_t best = 0;
+  float best_distance = -1.0f;
+  for (size_t i = 0; i < n_points; i++) {
+    const glm::vec3 d = points[i] - from;
+    const float distance = glm::dot(d, d);
+    if (distance > best_distance) {
+      best_distance = distance;
+      best = i;
+    }
+  }
+  return best;
+}
+
+BoundingSphere BoundingSphere::fromPoints(const glm::vec3 *points,
+                                          size_t n_points) {
+  if (n_points == 0) {
+    return BoundingSphere();
+  }
+  // Ritter: start with the sphere through two distant points and grow it
+  // just enough to take in every point left outside.
+  const glm::vec3 &a = points[farthest(points, n_points, points[0])];
+  const glm::vec3 &b = points[farthest(points, n_points, a)];
+  BoundingSphere ritter((a + b) * 0.5f, glm::length(b - a) * 0.5f);
+  for (size_t i = 0; i < n_points; i++) {
+    const float distance = glm::length(points[i] - ritter.center);
+    if (distance > ritter.radius) {
+      const float radius = (ritter.radius + distance) * 0.5f;
+      ritter.center += (points[i] - ritter.center) *
+                       ((radius - ritter.radius) / distance);
+      ritter.radius = radius;
+    }
+  }
+
+  const glm::vec3 center =
+      BoundingBox::fromPoints(points, n_points).getCenter();
+  float radius = 0.0f;
+  for (size_t i = 0; i < n_points; i++) {
+    const glm::vec3 d = points[i] - center;
+    radius = std::max(radius, glm::dot(d, d));
+  }
+  radius = std::sqrt(radius);
+  return radius < ritter.radius ? BoundingSphere(center, radius) : ritter;
+}
+
+bool BoundingSphere::isEmpty() const { return radius < 0.0f; }
+
+BoundingSphere BoundingSphere::transform(const glm::mat4 &matrix) const {
+  if (isEmpty()) {
+    return *this;
+  }
+  float scale = 0.0f;
+  for (int col = 0; col < 3; col++) {
+    const glm::vec3 axis(matrix[col]);
+    scale = std::max(scale, glm::dot(axis, axis));
+  }
+  return BoundingSphere(glm::vec3(matrix * glm::vec4(center, 1.0f)),
+                        radius * std::sqrt(scale));
+}
+
+//////////////////////////////////////////////////////////////////////// Frustum
+
+// Clip-space bounds -w <= x, y, z <= w are dot(row3 +- row_i, p) >= 0.
+Frustum::Frustum(const glm::mat4 &view_projection) {
+  const glm::mat4 m = glm::transpose(view_projection);
+  for (int i = 0; i < 3; i++) {
+    planes[2 * i] = m[3] + m[i];
+    planes[2 * i + 1] = m[3] - m[i];
+  }
+  for (glm::vec4 &plane : planes) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+}
+
+bool Frustum::contains(const glm::vec3 &point) const {
+  for (const glm::vec4 &plane : planes) {
+    if (glm::dot(plane, glm::vec4(point, 1.0f)) < 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Frustum::intersects(const BoundingBox &box) const {
+  if (box.isEmpty()) {
+    return false;
+  }
+  const glm::vec3 center = box.getCenter(), extent = box.getExtent();
+  for (const glm::vec4 &plane : planes) {
+    const glm::vec3 normal(plane);
+    if (glm::dot(normal, center) + plane.w +
+            glm::dot(glm::abs(normal), extent) <
+        0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Frustum::intersects(const BoundingSphere &sphere) const {
+  if (sphere.isEmpty()) {
+    return false;
+  }
+  for (const glm::vec4 &plane : planes) {
+    if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////// KERNELS
+
+typedef const float *const Inputs[BoundsBatch::COMPONENTS];
+
+// A box is outside when it lies entirely behind any plane: its center's
+// distance plus its projected radius is negative. One bit per lane.
+template <typename L>
+static size_t cullRange(Inputs b, const Frustum &frustum,
+                        unsigned char *visible, size_t begin, size_t end,
+                        size_t &n_visible) {
+  typedef typename L::V V;
+  V normal[6][3], absolute[6][3], distance[6];
+  for (int p = 0; p < 6; p++) {
+    for (int c = 0; c < 3; c++) {
+      normal[p][c] = L::set(frustum.planes[p][c]);
+      absolute[p][c] = L::set(std::abs(frustum.planes[p][c]));
+    }
+    distance[p] = L::set(frustum.planes[p].w);
+  }
+  const V zero = L::set(0.0f);
+  size_t i = begin;
+  for (; i + L::N <= end; i += L::N) {
+    V center[3], extent[3];
+    for (int c = 0; c < 3; c++) {
+      center[c] = L::load(b[BoundsBatch::CX + c] + i);
+      extent[c] = L::load(b[BoundsBatch::EX + c] + i);
+    }
+    int outside = 0;
+    for (int p = 0; p < 6; p++) {
+      V d = distance[p];
+      for (int c = 0; c < 3; c++) {
+        d = L::add(d, L::mul(normal[p][c], center[c]));
+        d = L::add(d, L::mul(absolute[p][c], extent[c]));
+      }
+      outside |= L::lessMask(d, zero);
+    }
+    for (size_t k = 0; k < L::N; k++) {
+      const unsigned char inside = (outside >> k) & 1 ? 0 : 1;
+      visible[i + k] = inside;
+      n_visible += inside;
+    }
+  }
+  return i;
+}
+
+//////////////////////////////////////////////////////////////////// BoundsBatch
+
+BoundsBatch::BoundsBatch(size_t n_boxes) : Size(0) { resize(n_boxes); }
+
+// Empty boxes have a huge negative extent, which pushes every plane
+// distance below zero without producing infinities times zero.
+void BoundsBatch::resize(size_t n_boxes) {
+  for (int c = 0; c < COMPONENTS; c++) {
+    Data[c].resize(n_boxes, c < EX ? 0.0f : -FLT_MAX);
+  }
+  Size = n_boxes;
+}
+
+size_t BoundsBatch::size() const { return Size; }
+
+float *BoundsBatch::data(Component component) {
+  return Data[component].data();
+}
+
+const float *BoundsBatch::data(Component component) const {
+  return Data[component].data();
+}
+
+void BoundsBatch::set(size_t i, const BoundingBox &box) {
+  const bool empty = box.isEmpty();
+  const glm::vec3 center = empty ? glm::vec3(0.0f) : box.getCenter();
+  const glm::vec3 extent = empty ? glm::vec3(-FLT_MAX) : box.getExtent();
+  for (int c = 0; c < 3; c++) {
+    Data[CX + c][i] = center[c];
+    Data[EX + c][i] = extent[c];
+  }
+}
+
+BoundingBox BoundsBatch::get(size_t i) const {
+  if (Data[EX][i] < 0.0f) {
+    return BoundingBox();
+  }
+  const glm::vec3 center(Data[CX][i], Data[CY][i], Data[CZ][i]);
+  const glm::vec3 extent(Data[EX][i], Data[EY][i], Data[EZ][i]);
+  return BoundingBox(center - extent, center + extent);
+}
+
+size_t BoundsBatch::cull(const Frustum &frustum,
+                         std::vector<unsigned char> &visible) {
+  typedef std::chrono::steady_clock clock;
+  const clock::time_point start = clock::now();
+  visible.resize(Size);
+  const float *in[COMPONENTS];
+  for (int c = 0; c < COMPONENTS; c++) {
+    in[c] = Data[c].data();
+  }
+  size_t n_visible = 0;
+  size_t i = cullRange<WideLanes>(in, frustum, visible.data(), 0, Size,
+                                  n_visible);
+  cullRange<ScalarLanes>(in, frustum, visible.data(), i, Size, n_visible);
+  Counters.visible = n_visible;
+  Counters.culled = Size - n_visible;
+  Counters.cullTime =
+      std::chrono::duration<double>(clock::now() - start).count();
+  return n_visible;
+}
+
+const BoundsBatch::Stats &BoundsBatch::getStats() const { return Counters; }
+
+const char *BoundsBatch::getInstructionSet() {
+  return getSimdInstructionSet();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}  // namespace mgl
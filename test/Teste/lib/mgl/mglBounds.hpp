@@ -0,0 +1,122 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Bounding Volumes and Frustum Culling
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_BOUNDS_HPP
+#define MGL_BOUNDS_HPP
+
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace mgl {
+
+struct BoundingBox;
+struct BoundingSphere;
+struct Frustum;
+class BoundsBatch;
+
+//////////////////////////////////////////////////////////////////// BoundingBox
+
+// Axis-aligned box. A default constructed box is empty (min above max) and
+// grows as points or boxes are added.
+
+struct BoundingBox {
+  glm::vec3 min, max;
+
+  BoundingBox();
+  BoundingBox(const glm::vec3 &min, const glm::vec3 &max);
+  static BoundingBox fromPoints(const glm::vec3 *points, size_t n_points);
+
+  bool isEmpty() const;
+  void add(const glm::vec3 &point);
+  void add(const BoundingBox &box);
+  bool overlaps(const BoundingBox &box) const;
+  glm::vec3 getCenter() const;
+  glm::vec3 getExtent() const;  // half the size along each axis
+  // Smallest box holding the transformed box (Arvo 1990).
+  BoundingBox transform(const glm::mat4 &matrix) const;
+};
+
+///////////////////////////////////////////////////////////////// BoundingSphere
+
+// A negative radius marks an empty sphere.
+
+struct BoundingSphere {
+  glm::vec3 center;
+  float radius;
+
+  BoundingSphere();
+  BoundingSphere(const glm::vec3 &center, float radius);
+  // Ritter's sphere or the sphere around the bounding box, whichever is
+  // smaller; within a few percent of the minimal sphere for typical meshes.
+  static BoundingSphere fromPoints(const glm::vec3 *points, size_t n_points);
+
+  bool isEmpty() const;
+  // Scales the radius by the largest axis scale of the matrix.
+  BoundingSphere transform(const glm::mat4 &matrix) const;
+};
+
+//////////////////////////////////////////////////////////////////////// Frustum
+
+// The six planes of a view frustum, extracted from a view-projection matrix
+// with OpenGL clip space (Gribb and Hartmann 2001) and normalized. Normals
+// point inside: a point p is inside a plane when dot(plane, vec4(p, 1)) >= 0.
+// The tests are conservative: boxes and spheres near the corners of the
+// frustum may be reported as intersecting when they are not.
+
+struct Frustum {
+  glm::vec4 planes[6];  // left, right, bottom, top, near, far
+
+  explicit Frustum(const glm::mat4 &view_projection);
+
+  bool contains(const glm::vec3 &point) const;
+  bool intersects(const BoundingBox &box) const;
+  bool intersects(const BoundingSphere &sphere) const;
+};
+
+//////////////////////////////////////////////////////////////////// BoundsBatch
+
+// Many boxes stored as centers and extents, one array per component, so that
+// frustum culling tests several boxes at once: 8 with AVX2, 4 with SSE2 and
+// one at a time otherwise (see PoseBatch). Empty boxes are always culled.
+
+class BoundsBatch {
+ public:
+  enum Component { CX, CY, CZ, EX, EY, EZ, COMPONENTS };
+  struct Stats {
+    size_t visible = 0;     // boxes intersecting the frustum in the last cull
+    size_t culled = 0;      // boxes outside it, empty ones included
+    double cullTime = 0.0;  // seconds in the last cull()
+  };
+
+  explicit BoundsBatch(size_t n_boxes = 0);
+  void resize(size_t n_boxes);
+  size_t size() const;
+
+  void set(size_t i, const BoundingBox &box);
+  BoundingBox get(size_t i) const;
+  float *data(Component component);
+  const float *data(Component component) const;
+
+  // Sets visible[i] to 1 when box i intersects the frustum and to 0
+  // otherwise; visible is resized to size(). Returns the visible count.
+  size_t cull(const Frustum &frustum, std::vector<unsigned char> &visible);
+  const Stats &getStats() const;
+
+  // "AVX2", "SSE2" or "scalar", as selected at compile time.
+  static const char *getInstructionSet();
+
+ private:
+  std::vector<float> Data[COMPONENTS];
+  size_t Size;
+  Stats Counters;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}  // namespace mgl
+
+#endif /* MGL_BOUNDS_HPP */
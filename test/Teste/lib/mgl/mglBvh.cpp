@@ -0,0 +1,393 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Bounding Volume Hierarchy (ray, nearest hit and overlap queries)
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglBvh.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+namespace mgl {
+
+//////////////////////////////////////////////////////////////////////////// Ray
+
+Ray::Ray(const glm::vec3 &origin, const glm::vec3 &direction,
+         float max_distance)
+    : origin(origin), direction(direction), maxDistance(max_distance) {}
+
+glm::vec3 Ray::at(float distance) const {
+  return origin + direction * distance;
+}
+
+Ray Ray::transform(const glm::mat4 &matrix) const {
+  return Ray(glm::vec3(matrix * glm::vec4(origin, 1.0f)),
+             glm::mat3(matrix) * direction, maxDistance);
+}
+
+float intersect(const Ray &ray, const BoundingBox &box) {
+  const glm::vec3 inverse = 1.0f / ray.direction;
+  const glm::vec3 t0 = (box.min - ray.origin) * inverse;
+  const glm::vec3 t1 = (box.max - ray.origin) * inverse;
+  const glm::vec3 lower = glm::min(t0, t1), upper = glm::max(t0, t1);
+  const float enter =
+      std::max(std::max(lower.x, lower.y), std::max(lower.z, 0.0f));
+  const float exit =
+      std::min(std::min(upper.x, upper.y), std::min(upper.z, ray.maxDistance));
+  return enter <= exit ? enter : -1.0f;
+}
+
+float intersect(const Ray &ray, const glm::vec3 &a, const glm::vec3 &b,
+                const glm::vec3 &c) {
+  const glm::vec3 e1 = b - a, e2 = c - a;
+  const glm::vec3 p = glm::cross(ray.direction, e2);
+  const float determinant = glm::dot(e1, p);
+  if (determinant == 0.0f) {
+    return -1.0f;  // parallel or degenerate
+  }
+  const float inverse = 1.0f / determinant;
+  const glm::vec3 s = ray.origin - a;
+  const float u = glm::dot(s, p) * inverse;
+  if (u < 0.0f || u > 1.0f) {
+    return -1.0f;
+  }
+  const glm::vec3 q = glm::cross(s, e1);
+  const float v = glm::dot(ray.direction, q) * inverse;
+  if (v < 0.0f || u + v > 1.0f) {
+    return -1.0f;
+  }
+  const float t = glm::dot(e2, q) * inverse;
+  return t >= 0.0f && t <= ray.maxDistance ? t : -1.0f;
+}
+
+//////////////////////////////////////////////////////////////////////////// Bvh
+
+static const int SAH_BINS = 16;
+
+// Zero for empty boxes, whose max is below their min.
+static float halfArea(const BoundingBox &box) {
+  const glm::vec3 d = glm::max(box.max - box.min, glm::vec3(0.0f));
+  return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+// Traversal stack entries; the stack never holds more than one pending
+// sibling per level, plus the root.
+struct BvhEntry {
+  uint32_t node;
+  float distance;
+};
+
+Bvh::Bvh() : BuildCost(0.0f) {}
+
+void Bvh::build(const BoundingBox *boxes, size_t n_boxes) {
+  typedef std::chrono::steady_clock clock;
+  const clock::time_point start = clock::now();
+  clear();
+  if (n_boxes == 0) {
+    return;
+  }
+  Building.resize(n_boxes);
+  for (size_t i = 0; i < n_boxes; i++) {
+    Building[i] = {boxes[i], boxes[i].getCenter(), static_cast<uint32_t>(i)};
+  }
+  Nodes.reserve(2 * n_boxes);
+  buildNode(0, static_cast<uint32_t>(n_boxes), 1);
+  Primitives.resize(n_boxes);
+  LeafBoxes.resize(n_boxes);
+  for (size_t i = 0; i < n_boxes; i++) {
+    Primitives[i] = Building[i].primitive;
+    LeafBoxes[i] = Building[i].box;
+  }
+  std::vector<BuildPrimitive>().swap(Building);
+
+  BuildCost = getCost();
+  Counters.nodes = Nodes.size();
+  Counters.buildTime =
+      std::chrono::duration<double>(clock::now() - start).count();
+#ifdef DEBUG
+  std::cout << "Built BVH [" << n_boxes << " primitives, " << Counters.nodes
+            << " nodes, depth " << Counters.depth << ", cost " << BuildCost
+            << ", " << Counters.buildTime * 1000.0 << " ms]" << std::endl;
+#endif
+}
+
+uint32_t Bvh::buildNode(uint32_t begin, uint32_t end, size_t depth) {
+  const uint32_t index = static_cast<uint32_t>(Nodes.size());
+  Nodes.push_back(Node());
+  BoundingBox bounds;
+  for (uint32_t i = begin; i < end; i++) {
+    bounds.add(Building[i].box);
+  }
+  Nodes[index].box = bounds;
+  Counters.depth = std::max(Counters.depth, depth);
+
+  uint32_t middle;
+  if (end - begin > 1 && split(begin, end, bounds, middle)) {
+    buildNode(begin, middle, depth + 1);
+    const uint32_t right = buildNode(middle, end, depth + 1);
+    Nodes[index].offset = right;
+    Nodes[index].count = 0;
+  } else {
+    Nodes[index].offset = begin;
+    Nodes[index].count = end - begin;
+    Counters.leaves++;
+  }
+  return index;
+}
+
+// Bins the centroids along each axis and picks the plane with the lowest
+// surface area cost, partitioning the primitives at middle. Returns false
+// when a leaf is cheaper.
+bool Bvh::split(uint32_t begin, uint32_t end, const BoundingBox &bounds,
+                uint32_t &middle) {
+  const uint32_t count = end - begin;
+  BoundingBox centers;
+  for (uint32_t i = begin; i < end; i++) {
+    centers.add(Building[i].centroid);
+  }
+  const glm::vec3 size = centers.max - centers.min;
+  // Small nodes need fewer planes.
+  const int n_bins = std::min(SAH_BINS, static_cast<int>(count));
+
+  float best_cost = FLT_MAX;
+  int best_axis = -1, best_bin = 0;
+  for (int axis = 0; axis < 3; axis++) {
+    if (size[axis] <= 0.0f) {
+      continue;
+    }
+    const float scale = n_bins / size[axis];
+    BoundingBox bins[SAH_BINS];
+    uint32_t counts[SAH_BINS] = {0};
+    for (uint32_t i = begin; i < end; i++) {
+      const BuildPrimitive &p = Building[i];
+      const int bin = std::min(
+          n_bins - 1,
+          static_cast<int>((p.centroid[axis] - centers.min[axis]) * scale));
+      bins[bin].add(p.box);
+      counts[bin]++;
+    }
+    // Sweep from the right to get the area and count past each plane.
+    float right_area[SAH_BINS];
+    uint32_t right_count[SAH_BINS];
+    BoundingBox right;
+    uint32_t n_right = 0;
+    for (int b = n_bins - 1; b > 0; b--) {
+      right.add(bins[b]);
+      n_right += counts[b];
+      right_area[b] = halfArea(right);
+      right_count[b] = n_right;
+    }
+    BoundingBox left;
+    uint32_t n_left = 0;
+    for (int b = 0; b < n_bins - 1; b++) {
+      left.add(bins[b]);
+      n_left += counts[b];
+      if (n_left == 0 || right_count[b + 1] == 0) {
+        continue;
+      }
+      const float cost = halfArea(left) * n_left +
+                         right_area[b + 1] * right_count[b + 1];
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_axis = axis;
+        best_bin = b;
+      }
+    }
+  }
+
+  const float area = halfArea(bounds);
+  const float split_cost =
+      area > 0.0f ? 1.0f + best_cost / area : static_cast<float>(count);
+  if (count <= MAX_LEAF_SIZE &&
+      (best_axis < 0 || split_cost >= static_cast<float>(count))) {
+    return false;
+  }
+  if (best_axis < 0) {
+    middle = begin + count / 2;  // coincident centroids: split in order
+    return true;
+  }
+  const float scale = n_bins / size[best_axis];
+  const float min = centers.min[best_axis];
+  const std::vector<BuildPrimitive>::iterator first = Building.begin();
+  const std::vector<BuildPrimitive>::iterator last = std::partition(
+      first + begin, first + end, [&](const BuildPrimitive &p) {
+        const float offset = (p.centroid[best_axis] - min) * scale;
+        return std::min(n_bins - 1, static_cast<int>(offset)) <= best_bin;
+      });
+  middle = static_cast<uint32_t>(last - first);
+  return true;
+}
+
+void Bvh::refit(const BoundingBox *boxes) {
+  typedef std::chrono::steady_clock clock;
+  const clock::time_point start = clock::now();
+  for (size_t i = 0; i < Primitives.size(); i++) {
+    LeafBoxes[i] = boxes[Primitives[i]];
+  }
+  // Children always follow their parent.
+  for (size_t i = Nodes.size(); i-- > 0;) {
+    Node &node = Nodes[i];
+    node.box = BoundingBox();
+    if (node.count > 0) {
+      for (uint32_t k = 0; k < node.count; k++) {
+        node.box.add(LeafBoxes[node.offset + k]);
+      }
+    } else {
+      node.box.add(Nodes[i + 1].box);
+      node.box.add(Nodes[node.offset].box);
+    }
+  }
+  Counters.refitTime =
+      std::chrono::duration<double>(clock::now() - start).count();
+}
+
+void Bvh::clear() {
+  Nodes.clear();
+  Primitives.clear();
+  LeafBoxes.clear();
+  BuildCost = 0.0f;
+  Counters = Stats();
+}
+
+size_t Bvh::size() const { return Primitives.size(); }
+
+bool Bvh::isEmpty() const { return Nodes.empty(); }
+
+float Bvh::primitiveDistance(uint32_t position, const Ray &ray,
+                             const RayTest &test) const {
+  const float distance = intersect(ray, LeafBoxes[position]);
+  if (distance < 0.0f || !test) {
+    return distance;
+  }
+  return test(Primitives[position], ray);
+}
+
+bool Bvh::raycast(const Ray &ray, Hit &hit, const RayTest &test) const {
+  hit = Hit();
+  if (Nodes.empty()) {
+    return false;
+  }
+  Ray r = ray;
+  std::vector<BvhEntry> stack;
+  stack.reserve(Counters.depth + 1);
+  const float root = intersect(r, Nodes[0].box);
+  if (root >= 0.0f) {
+    stack.push_back({0, root});
+  }
+  while (!stack.empty()) {
+    const BvhEntry entry = stack.back();
+    stack.pop_back();
+    if (entry.distance > r.maxDistance) {
+      continue;  // a nearer hit was found since it was pushed
+    }
+    const Node &node = Nodes[entry.node];
+    if (node.count > 0) {
+      for (uint32_t k = 0; k < node.count; k++) {
+        const float distance = primitiveDistance(node.offset + k, r, test);
+        if (distance >= 0.0f && distance <= r.maxDistance) {
+          hit.primitive = Primitives[node.offset + k];
+          hit.distance = distance;
+          r.maxDistance = distance;
+        }
+      }
+      continue;
+    }
+    BvhEntry first = {entry.node + 1, intersect(r, Nodes[entry.node + 1].box)};
+    BvhEntry second = {node.offset, intersect(r, Nodes[node.offset].box)};
+    if (first.distance >= 0.0f && second.distance >= 0.0f &&
+        second.distance < first.distance) {
+      std::swap(first, second);
+    }
+    // The nearer child is popped first.
+    if (second.distance >= 0.0f) {
+      stack.push_back(second);
+    }
+    if (first.distance >= 0.0f) {
+      stack.push_back(first);
+    }
+  }
+  return hit.primitive != ~0u;
+}
+
+bool Bvh::intersects(const Ray &ray, const RayTest &test) const {
+  if (Nodes.empty()) {
+    return false;
+  }
+  std::vector<uint32_t> stack(1, 0);
+  stack.reserve(Counters.depth + 1);
+  while (!stack.empty()) {
+    const uint32_t index = stack.back();
+    const Node &node = Nodes[index];
+    stack.pop_back();
+    if (intersect(ray, node.box) < 0.0f) {
+      continue;
+    }
+    if (node.count > 0) {
+      for (uint32_t k = 0; k < node.count; k++) {
+        if (primitiveDistance(node.offset + k, ray, test) >= 0.0f) {
+          return true;
+        }
+      }
+    } else {
+      stack.push_back(node.offset);
+      stack.push_back(index + 1);
+    }
+  }
+  return false;
+}
+
+void Bvh::overlap(const BoundingBox &box,
+                  std::vector<uint32_t> &primitives) const {
+  if (Nodes.empty()) {
+    return;
+  }
+  std::vector<uint32_t> stack(1, 0);
+  stack.reserve(Counters.depth + 1);
+  while (!stack.empty()) {
+    const uint32_t index = stack.back();
+    const Node &node = Nodes[index];
+    stack.pop_back();
+    if (!node.box.overlaps(box)) {
+      continue;
+    }
+    if (node.count > 0) {
+      for (uint32_t k = 0; k < node.count; k++) {
+        if (LeafBoxes[node.offset + k].overlaps(box)) {
+          primitives.push_back(Primitives[node.offset + k]);
+        }
+      }
+    } else {
+      stack.push_back(node.offset);
+      stack.push_back(index + 1);
+    }
+  }
+}
+
+float Bvh::getCost() const {
+  if (Nodes.empty()) {
+    return 0.0f;
+  }
+  const float root = halfArea(Nodes[0].box);
+  if (root <= 0.0f) {
+    return static_cast<float>(Primitives.size());
+  }
+  float cost = 0.0f;
+  for (const Node &node : Nodes) {
+    cost += halfArea(node.box) * (node.count > 0 ? node.count : 1.0f);
+  }
+  return cost / root;
+}
+
+float Bvh::getBuildCost() const { return BuildCost; }
+
+const std::vector<Bvh::Node> &Bvh::getNodes() const { return Nodes; }
+
+const Bvh::Stats &Bvh::getStats() const { return Counters; }
+
+////////////////////////////////////////////////////////////////////////////////
+}  // namespace mgl
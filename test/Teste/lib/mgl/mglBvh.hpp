@@ -0,0 +1,135 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Bounding Volume Hierarchy (ray, nearest hit and overlap queries)
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_BVH_HPP
+#define MGL_BVH_HPP
+
+#include <cfloat>
+#include <cstdint>
+#include <functional>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "./mglBounds.hpp"
+
+namespace mgl {
+
+struct Ray;
+class Bvh;
+
+//////////////////////////////////////////////////////////////////////////// Ray
+
+// Distances are measured in units of direction, which need not be normalized.
+// An affine transform keeps them unchanged, so hits found on a ray transformed
+// into object space are directly comparable with world-space hits.
+
+struct Ray {
+  glm::vec3 origin;
+  glm::vec3 direction;
+  float maxDistance;
+
+  Ray(const glm::vec3 &origin, const glm::vec3 &direction,
+      float max_distance = FLT_MAX);
+  glm::vec3 at(float distance) const;
+  Ray transform(const glm::mat4 &matrix) const;
+};
+
+// Distance at which the ray enters the box (0 when it starts inside) or a
+// negative value when it misses it within maxDistance.
+float intersect(const Ray &ray, const BoundingBox &box);
+// Distance to a triangle, either side facing (Moller and Trumbore 1997), or
+// a negative value when missed within maxDistance.
+float intersect(const Ray &ray, const glm::vec3 &a, const glm::vec3 &b,
+                const glm::vec3 &c);
+
+//////////////////////////////////////////////////////////////////////////// Bvh
+
+// Binary hierarchy over the boxes of any kind of primitive, built with the
+// surface area heuristic over binned centroids. Nodes are stored depth first:
+// the left child follows its parent and the right child is at offset.
+//
+// refit() recomputes the boxes bottom-up for moved primitives, keeping the
+// tree, which is much cheaper than build() but degrades as primitives drift
+// from where they were built; getCost() against getBuildCost() tells when a
+// rebuild pays off.
+//
+// Queries take an optional exact test: without it a primitive is hit where
+// its box is. The test is given the ray with maxDistance shortened to the
+// nearest hit so far.
+
+class Bvh {
+ public:
+  struct Node {
+    BoundingBox box;
+    uint32_t offset;  // right child, or first primitive of a leaf
+    uint32_t count;   // primitives in a leaf, 0 for inner nodes
+  };
+  struct Hit {
+    uint32_t primitive = ~0u;
+    float distance = FLT_MAX;
+  };
+  struct Stats {
+    size_t nodes = 0;
+    size_t leaves = 0;
+    size_t depth = 0;
+    double buildTime = 0.0;  // seconds in the last build()
+    double refitTime = 0.0;  // seconds in the last refit()
+  };
+  // Distance to the primitive along the ray, or negative when missed.
+  typedef std::function<float(uint32_t primitive, const Ray &ray)> RayTest;
+
+  static const uint32_t MAX_LEAF_SIZE = 4;
+
+  Bvh();
+  void build(const BoundingBox *boxes, size_t n_boxes);
+  // boxes must hold as many boxes, in the same order, as given to build().
+  void refit(const BoundingBox *boxes);
+  void clear();
+  size_t size() const;
+  bool isEmpty() const;
+
+  // Nearest hit along the ray.
+  bool raycast(const Ray &ray, Hit &hit, const RayTest &test = RayTest()) const;
+  // Whether anything is hit, stopping at the first hit found.
+  bool intersects(const Ray &ray, const RayTest &test = RayTest()) const;
+  // Appends the primitives whose boxes overlap the box.
+  void overlap(const BoundingBox &box, std::vector<uint32_t> &primitives) const;
+
+  // Expected cost of a ray query, in primitive tests, relative to the root.
+  float getCost() const;
+  float getBuildCost() const;
+  const std::vector<Node> &getNodes() const;
+  const Stats &getStats() const;
+
+ private:
+  // Partitioned in place during build(), so that each node reads its
+  // primitives sequentially.
+  struct BuildPrimitive {
+    BoundingBox box;
+    glm::vec3 centroid;
+    uint32_t primitive;
+  };
+
+  std::vector<Node> Nodes;
+  std::vector<uint32_t> Primitives;    // in leaf order
+  std::vector<BoundingBox> LeafBoxes;  // primitive boxes, in leaf order
+  std::vector<BuildPrimitive> Building;
+  float BuildCost;
+  Stats Counters;
+
+  uint32_t buildNode(uint32_t begin, uint32_t end, size_t depth);
+  bool split(uint32_t begin, uint32_t end, const BoundingBox &bounds,
+             uint32_t &middle);
+  float primitiveDistance(uint32_t position, const Ray &ray,
+                          const RayTest &test) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}  // namespace mgl
+
+#endif /* MGL_BVH_HPP */
@@ -10,42 +10,76 @@
 
 #include <glm/gtc/type_ptr.hpp>
 
+#include "./mglState.hpp"
+
 namespace mgl {
 
 ///////////////////////////////////////////////////////////////////////// Camera
 
 Camera::Camera(GLuint bindingpoint)
-    : ViewMatrix(glm::mat4(1.0f)), ProjectionMatrix(glm::mat4(1.0f)) {
+    : BindingPoint(bindingpoint), ViewMatrix(glm::mat4(1.0f)),
+      ProjectionMatrix(glm::mat4(1.0f)), Stream(nullptr), Dirty(true) {
+  State &state = State::getInstance();
   glGenBuffers(1, &UboId);
-  glBindBuffer(GL_UNIFORM_BUFFER, UboId);
+  state.bindBuffer(GL_UNIFORM_BUFFER, UboId);
   glBufferData(GL_UNIFORM_BUFFER, sizeof(glm::mat4) * 2, 0, GL_STREAM_DRAW);
-  glBindBufferBase(GL_UNIFORM_BUFFER, bindingpoint, UboId);
-  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  state.bindBufferBase(GL_UNIFORM_BUFFER, bindingpoint, UboId);
 }
 
 Camera::~Camera() {
-  glBindBuffer(GL_UNIFORM_BUFFER, 0);
-  glDeleteBuffers(1, &UboId);
+  State::getInstance().deleteBuffers(1, &UboId);
 }
 
 glm::mat4 Camera::getViewMatrix() const { return ViewMatrix; }
 
 void Camera::setViewMatrix(const glm::mat4 &viewmatrix) {
   ViewMatrix = viewmatrix;
-  glBindBuffer(GL_UNIFORM_BUFFER, UboId);
+  Dirty = true;
+  if (Stream) {
+    return;
+  }
+  State::getInstance().bindBuffer(GL_UNIFORM_BUFFER, UboId);
   glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4),
                   glm::value_ptr(ViewMatrix));
-  glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
 glm::mat4 Camera::getProjectionMatrix() const { return ProjectionMatrix; }
 
 void Camera::setProjectionMatrix(const glm::mat4 &projectionmatrix) {
   ProjectionMatrix = projectionmatrix;
-  glBindBuffer(GL_UNIFORM_BUFFER, UboId);
+  Dirty = true;
+  if (Stream) {
+    return;
+  }
+  State::getInstance().bindBuffer(GL_UNIFORM_BUFFER, UboId);
   glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4),
                   glm::value_ptr(ProjectionMatrix));
-  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void Camera::setStreamBuffer(StreamBuffer *stream) {
+  Stream = stream;
+  Block = StreamBuffer::Allocation();
+  Dirty = true;
+  if (!Stream) {
+    // Back to the camera's own UBO, which may be out of date.
+    State &state = State::getInstance();
+    state.bindBuffer(GL_UNIFORM_BUFFER, UboId);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4),
+                    glm::value_ptr(ViewMatrix));
+    glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4),
+                    glm::value_ptr(ProjectionMatrix));
+    state.bindBufferBase(GL_UNIFORM_BUFFER, BindingPoint, UboId);
+  }
+}
+
+void Camera::bind() {
+  if (!Stream || (!Dirty && Stream->isValid(Block))) {
+    return;
+  }
+  glm::mat4 matrices[2] = {ViewMatrix, ProjectionMatrix};
+  Block = Stream->write(matrices, sizeof(matrices));
+  Stream->bindRange(GL_UNIFORM_BUFFER, BindingPoint, Block);
+  Dirty = false;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -13,6 +13,8 @@
 
 #include <glm/glm.hpp>
 
+#include "./mglStreamBuffer.hpp"
+
 namespace mgl {
 
 class Camera;
@@ -22,8 +24,12 @@ class Camera;
 class Camera {
  private:
   GLuint UboId;
+  GLuint BindingPoint;
   glm::mat4 ViewMatrix;
   glm::mat4 ProjectionMatrix;
+  StreamBuffer *Stream;
+  StreamBuffer::Allocation Block;
+  bool Dirty;
 
  public:
   explicit Camera(GLuint bindingpoint);
@@ -32,6 +38,11 @@ class Camera {
   void setViewMatrix(const glm::mat4 &viewmatrix);
   glm::mat4 getProjectionMatrix() const;
   void setProjectionMatrix(const glm::mat4 &projectionmatrix);
+  // When streaming, the matrices are written to the stream buffer instead of
+  // the camera's own UBO, and bind() must be called once per frame before
+  // drawing; it writes the 128 bytes of matrices again every frame.
+  void setStreamBuffer(StreamBuffer *stream);
+  void bind();
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -19,6 +19,15 @@ const char VIEW_MATRIX[] = "ViewMatrix";
 const char PROJECTION_MATRIX[] = "ProjectionMatrix";
 const char TEXTURE_MATRIX[] = "TextureMatrix";
 const char CAMERA_BLOCK[] = "Camera";
+const char MESH_COLOR[] = "meshColor";
+
+// Per-draw data for indirect drawing: a std430 array of { mat4 ModelMatrix;
+// vec4 Color; vec4 PositionScale; vec4 PositionBias; vec4 TexcoordDecode; }
+// bound at DRAW_DATA_BINDING and indexed by gl_BaseInstanceARB +
+// gl_InstanceID. PositionScale.w holds the DECODE_* flags and TexcoordDecode
+// the texcoord scale (xy) and bias (zw).
+const char DRAW_DATA_BLOCK[] = "DrawData";
+const unsigned int DRAW_DATA_BINDING = 0;
 
 const char POSITION_ATTRIBUTE[] = "inPosition";
 const char NORMAL_ATTRIBUTE[] = "inNormal";
@@ -26,6 +35,20 @@ const char TEXCOORD_ATTRIBUTE[] = "inTexcoord";
 const char TANGENT_ATTRIBUTE[] = "inTangent";
 const char BITANGENT_ATTRIBUTE[] = "inBitangent";
 const char COLOR_ATTRIBUTE[] = "inColor";
+const char INSTANCE_MATRIX_ATTRIBUTE[] = "inInstanceMatrix";
+const char INSTANCE_COLOR_ATTRIBUTE[] = "inInstanceColor";
+
+// Vertex decoding for quantized meshes. VERTEX_DECODE holds the DECODE_*
+// flags of the bound mesh and is 0 (plain float attributes) when unset.
+const char VERTEX_DECODE[] = "VertexDecode";
+const char POSITION_SCALE[] = "PositionScale";
+const char POSITION_BIAS[] = "PositionBias";
+const char TEXCOORD_SCALE[] = "TexcoordScale";
+const char TEXCOORD_BIAS[] = "TexcoordBias";
+
+const int DECODE_POSITION = 1;    // position * PositionScale + PositionBias
+const int DECODE_TEXCOORD = 2;    // texcoord * TexcoordScale + TexcoordBias
+const int DECODE_OCTAHEDRAL = 4;  // normal and tangents are octahedral .xy
 
 ////////////////////////////////////////////////////////////////////////////////
 }  // namespace mgl
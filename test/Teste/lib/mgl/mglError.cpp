@@ -12,6 +12,8 @@
 
 #include <iostream>
 
+#include "./mglState.hpp"
+
 //////////////////////////////////////////////////////////// ERRORS (OPENGL 2.0)
 
 const std::string errorString(GLenum error) {
@@ -135,8 +137,8 @@ void setupDebugOutput() {
   if (context_flags & GL_CONTEXT_FLAG_DEBUG_BIT) {
     std::cout << "Debug context created." << std::endl;
   }
-  glEnable(GL_DEBUG_OUTPUT);
-  glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+  mgl::State::getInstance().enable(GL_DEBUG_OUTPUT);
+  mgl::State::getInstance().enable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
   glDebugMessageCallback(error, nullptr);
   glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr,
                         GL_TRUE);
@@ -0,0 +1,297 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Indirect Draw Submission Class
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglIndirectRenderer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "./mglConventions.hpp"
+#include "./mglState.hpp"
+
+namespace mgl {
+
+/////////////////////////////////////////////////////////////// IndirectRenderer
+
+IndirectRenderer::IndirectRenderer(StreamBuffer *stream)
+    : Stream(stream), StorageAlignment(0), ViewMatrix(1.0f),
+      Instances(stream) {
+  // Indirect shaders are #version 430 and read gl_BaseInstanceARB, so they
+  // compile on 4.3 to 4.5 drivers; the extension is required even on 4.6.
+  Indirect = (GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect &&
+                                   GLEW_ARB_shader_storage_buffer_object)) &&
+             GLEW_ARB_shader_draw_parameters;
+  if (Indirect) {
+    GLint alignment = 0;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    StorageAlignment = alignment;
+  }
+#ifdef DEBUG
+  std::cout << "Draw submission: "
+            << (Indirect ? "multi-draw indirect" : "per-draw") << std::endl;
+#endif
+}
+
+bool IndirectRenderer::isIndirect() const { return Indirect; }
+
+const IndirectRenderer::Stats &IndirectRenderer::getStats() const {
+  return Counters;
+}
+
+void IndirectRenderer::setViewMatrix(const glm::mat4 &view_matrix) {
+  ViewMatrix = view_matrix;
+}
+
+void IndirectRenderer::submit(Mesh *mesh, ShaderProgram *shader,
+                              const glm::mat4 &model_matrix,
+                              const glm::vec3 &color, unsigned int layer,
+                              bool transparent) {
+  Draws.push_back({mesh, shader, model_matrix, color, layer, transparent});
+}
+
+// Handles to the vertex decode uniforms (mglConventions.hpp) of a program.
+struct DecodeUniforms {
+  Uniform<GLint> flags;
+  Uniform<glm::vec3> positionScale, positionBias;
+  Uniform<glm::vec2> texcoordScale, texcoordBias;
+
+  void get(ShaderProgram *shader) {
+    flags = shader->getUniform<GLint>(VERTEX_DECODE);
+    positionScale = shader->getUniform<glm::vec3>(POSITION_SCALE);
+    positionBias = shader->getUniform<glm::vec3>(POSITION_BIAS);
+    texcoordScale = shader->getUniform<glm::vec2>(TEXCOORD_SCALE);
+    texcoordBias = shader->getUniform<glm::vec2>(TEXCOORD_BIAS);
+  }
+  void set(ShaderProgram *shader, const Mesh::VertexDecode &decode) const {
+    shader->set(flags, decode.flags);
+    shader->set(positionScale, decode.positionScale);
+    shader->set(positionBias, decode.positionBias);
+    shader->set(texcoordScale, decode.texcoordScale);
+    shader->set(texcoordBias, decode.texcoordBias);
+  }
+};
+
+// Ids are handed out in order of first use and kept across frames.
+template <typename K>
+static uint32_t compactId(std::unordered_map<K, uint32_t> &ids, K key) {
+  return ids.insert(std::make_pair(key, static_cast<uint32_t>(ids.size())))
+      .first->second;
+}
+
+void IndirectRenderer::sortDraws() {
+  Queue.clear();
+  for (size_t i = 0; i < Draws.size(); i++) {
+    const Draw &draw = Draws[i];
+    const glm::vec4 eye = ViewMatrix * draw.modelMatrix[3];
+    Queue.push(RenderQueue::makeKey(
+                   draw.layer, draw.transparent,
+                   compactId<const void *>(ProgramIds, draw.shader), 0,
+                   compactId(VaoIds, draw.mesh->getVertexArray()),
+                   compactId<const void *>(MeshIds, draw.mesh), -eye.z),
+               static_cast<uint32_t>(i));
+  }
+  Queue.sort();
+  Sorted.clear();
+  for (const DrawPacket &packet : Queue.getPackets()) {
+    Sorted.push_back(Draws[packet.index]);
+  }
+  Draws.swap(Sorted);
+}
+
+unsigned int IndirectRenderer::getPass(const Draw &draw) {
+  return draw.layer * 2 + (draw.transparent ? 1 : 0);
+}
+
+size_t IndirectRenderer::sameDraws(size_t begin) const {
+  size_t end = begin + 1;
+  while (end < Draws.size() && Draws[end].shader == Draws[begin].shader &&
+         Draws[end].mesh == Draws[begin].mesh &&
+         getPass(Draws[end]) == getPass(Draws[begin])) {
+    end++;
+  }
+  return end;
+}
+
+void IndirectRenderer::setBlending(unsigned int pass) {
+  if (pass & 1) {
+    State::getInstance().enable(GL_BLEND);
+  } else {
+    State::getInstance().disable(GL_BLEND);
+  }
+}
+
+void IndirectRenderer::flush() {
+  typedef std::chrono::steady_clock clock;
+  const clock::time_point start = clock::now();
+  Counters = Stats();
+  if (Draws.empty()) {
+    return;
+  }
+  Counters.draws = Draws.size();
+  sortDraws();
+  const clock::time_point sorted = clock::now();
+  if (Indirect) {
+    flushIndirect();
+  } else {
+    flushDirect();
+  }
+  setBlending(0);
+  Draws.clear();
+  Counters.sortTime = std::chrono::duration<double>(sorted - start).count();
+  Counters.flushTime =
+      std::chrono::duration<double>(clock::now() - start).count();
+}
+
+void IndirectRenderer::flushDirect() {
+  ShaderProgram *bound = nullptr;
+  Uniform<glm::mat4> model_matrix;
+  Uniform<glm::vec3> color;
+  DecodeUniforms decode;
+  bool instanced = false;
+  GLuint vao = 0;
+  size_t begin = 0;
+  while (begin < Draws.size()) {
+    const size_t end = sameDraws(begin);
+    setBlending(getPass(Draws[begin]));
+    if (Draws[begin].mesh->getVertexArray() != vao) {
+      vao = Draws[begin].mesh->getVertexArray();
+      Counters.vertexArrayChanges++;
+    }
+    if (Draws[begin].shader != bound) {
+      bound = Draws[begin].shader;
+      bound->bind();
+      Counters.programChanges++;
+      instanced = bound->isAttribute(INSTANCE_MATRIX_ATTRIBUTE);
+      model_matrix = bound->getUniform<glm::mat4>(MODEL_MATRIX);
+      color = bound->getUniform<glm::vec3>(MESH_COLOR);
+      decode.get(bound);
+    }
+    decode.set(bound, Draws[begin].mesh->getVertexDecode());
+    if (instanced) {
+      Instances.clear();
+      for (size_t i = begin; i < end; i++) {
+        Instances.add(Draws[i].modelMatrix, Draws[i].color);
+      }
+      Instances.draw(Draws[begin].mesh);
+      Counters.commands++;
+      Counters.drawCalls++;
+    } else {
+      for (size_t i = begin; i < end; i++) {
+        bound->set(model_matrix, Draws[i].modelMatrix);
+        bound->set(color, Draws[i].color);
+        Draws[i].mesh->draw();
+        Counters.commands++;
+        Counters.drawCalls++;
+      }
+    }
+    begin = end;
+  }
+}
+
+IndirectRenderer::DrawData IndirectRenderer::makeDrawData(const Draw &draw) {
+  const Mesh::VertexDecode &decode = draw.mesh->getVertexDecode();
+  return {draw.modelMatrix, glm::vec4(draw.color, 1.0f),
+          glm::vec4(decode.positionScale, static_cast<float>(decode.flags)),
+          glm::vec4(decode.positionBias, 0.0f),
+          glm::vec4(decode.texcoordScale, decode.texcoordBias)};
+}
+
+void IndirectRenderer::flushIndirect() {
+  Commands.clear();
+  size_t first = 0;
+  while (first < Draws.size()) {
+    const size_t last = sameDraws(first);
+    const Draw &draw = Draws[first];
+    MeshCommands.clear();
+    draw.mesh->getDrawCommands(MeshCommands);
+    const GLuint vao = draw.mesh->getVertexArray();
+    for (const Mesh::DrawCommand &c : MeshCommands) {
+      Commands.push_back({getPass(draw), draw.shader, draw.mesh, vao,
+                          c.indexType,
+                          {c.count, static_cast<GLuint>(last - first),
+                           c.firstIndex, c.baseVertex,
+                           static_cast<GLuint>(first)}});
+    }
+    first = last;
+  }
+  // Transparent passes keep their back-to-front order.
+  std::stable_sort(Commands.begin(), Commands.end(),
+                   [](const Command &a, const Command &b) {
+                     if (a.pass != b.pass) return a.pass < b.pass;
+                     if (a.pass & 1) return false;
+                     if (a.shader != b.shader) return a.shader < b.shader;
+                     if (a.vao != b.vao) return a.vao < b.vao;
+                     return a.indexType < b.indexType;
+                   });
+
+  // Each multi-draw writes the draw data of its own commands, so that
+  // baseInstance indexes the range bound for it. Like InstanceBuffer, large
+  // batches are split so the data and the commands of a chunk each take at
+  // most half a frame of the stream; a command with more instances than
+  // that is split across chunks too.
+  const size_t max_draws = std::max<size_t>(
+      1, Stream->getFrameSize() / 2 / sizeof(DrawData));
+  const size_t max_commands = std::max<size_t>(
+      1, Stream->getFrameSize() / 2 / sizeof(DrawElementsIndirectCommand));
+  const Command *previous = nullptr;
+  size_t next = 0;
+  GLuint done = 0;  // instances of Commands[next] already drawn
+  while (next < Commands.size()) {
+    const Command &batch = Commands[next];
+    Data.clear();
+    Buffer.clear();
+    while (next < Commands.size() && Commands[next].pass == batch.pass &&
+           Commands[next].shader == batch.shader &&
+           Commands[next].vao == batch.vao &&
+           Commands[next].indexType == batch.indexType &&
+           Data.size() < max_draws && Buffer.size() < max_commands) {
+      DrawElementsIndirectCommand command = Commands[next].command;
+      const GLuint count = static_cast<GLuint>(std::min<size_t>(
+          command.instanceCount - done, max_draws - Data.size()));
+      const size_t draw = command.baseInstance + done;
+      command.instanceCount = count;
+      command.baseInstance = static_cast<GLuint>(Data.size());
+      for (size_t i = draw; i < draw + count; i++) {
+        Data.push_back(makeDrawData(Draws[i]));
+      }
+      Buffer.push_back(command);
+      done += count;
+      if (done == Commands[next].command.instanceCount) {
+        next++;
+        done = 0;
+      }
+    }
+
+    const StreamBuffer::Allocation data = Stream->write(
+        Data.data(), Data.size() * sizeof(DrawData), StorageAlignment);
+    const StreamBuffer::Allocation commands = Stream->write(
+        Buffer.data(), Buffer.size() * sizeof(DrawElementsIndirectCommand));
+    Stream->bindRange(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, data);
+    State::getInstance().bindBuffer(GL_DRAW_INDIRECT_BUFFER, commands.buffer);
+
+    if (!previous || previous->shader != batch.shader) {
+      Counters.programChanges++;
+    }
+    if (!previous || previous->vao != batch.vao) {
+      Counters.vertexArrayChanges++;
+    }
+    previous = &batch;
+    setBlending(batch.pass);
+    batch.shader->bind();
+    batch.mesh->bind();
+    glMultiDrawElementsIndirect(GL_TRIANGLES, batch.indexType,
+                                reinterpret_cast<const void *>(commands.offset),
+                                static_cast<GLsizei>(Buffer.size()), 0);
+    Counters.commands += Buffer.size();
+    Counters.drawCalls++;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
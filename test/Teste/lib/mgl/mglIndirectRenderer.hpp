@@ -0,0 +1,140 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Indirect Draw Submission Class
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_INDIRECT_RENDERER_HPP
+#define MGL_INDIRECT_RENDERER_HPP
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+#include "./mglInstancing.hpp"
+#include "./mglMesh.hpp"
+#include "./mglRenderQueue.hpp"
+#include "./mglShader.hpp"
+#include "./mglStreamBuffer.hpp"
+
+namespace mgl {
+
+class IndirectRenderer;
+
+/////////////////////////////////////////////////////////////// IndirectRenderer
+
+// Collects the draws of a frame and submits them with one
+// glMultiDrawElementsIndirect per shader, vertex array and index type. Meshes
+// sharing a MeshArena share a vertex array, so a whole scene usually goes out
+// in a handful of calls. Draws of the same mesh and shader become a single
+// instanced command. Commands and per-draw data (mglConventions.hpp,
+// DRAW_DATA_BLOCK) are written to a StreamBuffer; the shader reads its draw
+// with gl_BaseInstanceARB + gl_InstanceID (GLSL 4.30 and
+// GL_ARB_shader_draw_parameters, see cube-mdi-vs.glsl). Buckets too large
+// for the stream's frame are submitted in several chunks.
+//
+// Without OpenGL 4.3 multi-draw indirect and GL_ARB_shader_draw_parameters,
+// draws sharing a mesh and shader are instanced through an InstanceBuffer
+// when the shader has INSTANCE_MATRIX_ATTRIBUTE, and are otherwise issued one
+// by one as before, setting MODEL_MATRIX and MESH_COLOR (see isIndirect()).
+//
+// Each mesh's VertexDecode goes with its draws: in the per-draw data for
+// indirect draws, and in the VERTEX_DECODE uniforms otherwise, so quantized
+// meshes render on every path.
+//
+// flush() orders the frame's draws with a RenderQueue: by layer, opaque
+// before transparent, opaque draws by program, vertex array and mesh and then
+// front-to-back, transparent draws back-to-front (blended with GL_BLEND).
+// Depth is measured with the matrix given to setViewMatrix(). Stats count the
+// program and vertex array changes and the CPU time of the frame's flush.
+
+struct DrawElementsIndirectCommand {
+  GLuint count;
+  GLuint instanceCount;
+  GLuint firstIndex;
+  GLint baseVertex;
+  GLuint baseInstance;
+};
+
+class IndirectRenderer {
+public:
+  struct Stats {
+    size_t draws = 0;       // submitted this frame
+    size_t commands = 0;    // one per submesh and mesh/shader pair
+    size_t drawCalls = 0;   // GL draw calls issued
+    size_t programChanges = 0;
+    size_t vertexArrayChanges = 0;
+    double sortTime = 0.0;   // seconds building keys and sorting
+    double flushTime = 0.0;  // seconds in flush(), sorting included
+  };
+
+  explicit IndirectRenderer(StreamBuffer *stream);
+  IndirectRenderer(const IndirectRenderer &) = delete;
+  IndirectRenderer &operator=(const IndirectRenderer &) = delete;
+
+  void setViewMatrix(const glm::mat4 &view_matrix);
+  void submit(Mesh *mesh, ShaderProgram *shader, const glm::mat4 &model_matrix,
+              const glm::vec3 &color, unsigned int layer = 0,
+              bool transparent = false);
+  void flush();
+
+  bool isIndirect() const;
+  const Stats &getStats() const;
+
+private:
+  struct Draw {
+    Mesh *mesh;
+    ShaderProgram *shader;
+    glm::mat4 modelMatrix;
+    glm::vec3 color;
+    unsigned int layer;
+    bool transparent;
+  };
+  struct DrawData {
+    glm::mat4 modelMatrix;
+    glm::vec4 color;
+    glm::vec4 positionScale;   // w holds the DECODE_* flags
+    glm::vec4 positionBias;
+    glm::vec4 texcoordDecode;  // scale in xy, bias in zw
+  };
+  struct Command {
+    unsigned int pass;  // layer and transparency, as in the sort key
+    ShaderProgram *shader;
+    Mesh *mesh;  // any mesh of the bucket, to bind its vertex array
+    GLuint vao;
+    GLenum indexType;
+    DrawElementsIndirectCommand command;
+  };
+
+  StreamBuffer *Stream;
+  bool Indirect;
+  GLsizeiptr StorageAlignment;
+  glm::mat4 ViewMatrix;
+  std::vector<Draw> Draws, Sorted;
+  RenderQueue Queue;
+  std::unordered_map<const void *, uint32_t> ProgramIds, MeshIds;
+  std::unordered_map<GLuint, uint32_t> VaoIds;
+  std::vector<Command> Commands;
+  std::vector<Mesh::DrawCommand> MeshCommands;
+  std::vector<DrawElementsIndirectCommand> Buffer;
+  std::vector<DrawData> Data;
+  InstanceBuffer Instances;
+  Stats Counters;
+
+  void sortDraws();
+  size_t sameDraws(size_t begin) const;
+  static unsigned int getPass(const Draw &draw);
+  static DrawData makeDrawData(const Draw &draw);
+  void setBlending(unsigned int pass);
+  void flushDirect();
+  void flushIndirect();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
+
+#endif /* MGL_INDIRECT_RENDERER_HPP */
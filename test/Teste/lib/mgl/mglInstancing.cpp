@@ -0,0 +1,67 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Instanced Drawing Class
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglInstancing.hpp"
+
+#include <algorithm>
+#include <cstddef>
+
+#include "./mglState.hpp"
+
+namespace mgl {
+
+///////////////////////////////////////////////////////////////// InstanceBuffer
+
+InstanceBuffer::InstanceBuffer(StreamBuffer *stream) : Stream(stream) {}
+
+void InstanceBuffer::add(const glm::mat4 &model_matrix,
+                         const glm::vec3 &color) {
+  Instances.push_back({model_matrix, glm::vec4(color, 1.0f)});
+}
+
+void InstanceBuffer::clear() { Instances.clear(); }
+
+size_t InstanceBuffer::size() const { return Instances.size(); }
+
+static void setInstanceAttributes(const StreamBuffer::Allocation &block) {
+  const GLsizei stride = sizeof(InstanceData);
+  State::getInstance().bindBuffer(GL_ARRAY_BUFFER, block.buffer);
+  for (GLuint column = 0; column < 4; column++) {
+    const GLuint index = Mesh::INSTANCE_MATRIX + column;
+    glEnableVertexAttribArray(index);
+    glVertexAttribPointer(index, 4, GL_FLOAT, GL_FALSE, stride,
+                          reinterpret_cast<void *>(
+                              block.offset + column * sizeof(glm::vec4)));
+    glVertexAttribDivisor(index, 1);
+  }
+  glEnableVertexAttribArray(Mesh::INSTANCE_COLOR);
+  glVertexAttribPointer(
+      Mesh::INSTANCE_COLOR, 4, GL_FLOAT, GL_FALSE, stride,
+      reinterpret_cast<void *>(block.offset + offsetof(InstanceData, color)));
+  glVertexAttribDivisor(Mesh::INSTANCE_COLOR, 1);
+}
+
+void InstanceBuffer::draw(Mesh *mesh) {
+  // Half a frame per chunk leaves room for what the frame wrote before, such
+  // as the camera block, so a chunk never outgrows the frame by itself.
+  const size_t chunk = std::max<size_t>(
+      1, Stream->getFrameSize() / 2 / sizeof(InstanceData));
+  for (size_t first = 0; first < Instances.size(); first += chunk) {
+    const size_t count = std::min(chunk, Instances.size() - first);
+    const StreamBuffer::Allocation block =
+        Stream->write(&Instances[first], count * sizeof(InstanceData));
+    // Arena meshes share their vertex array, so the instance attributes are
+    // pointed at this block on every draw.
+    mesh->bind();
+    setInstanceAttributes(block);
+    mesh->drawInstanced(static_cast<GLsizei>(count));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
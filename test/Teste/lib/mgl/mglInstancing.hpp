@@ -0,0 +1,56 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Instanced Drawing Class
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_INSTANCING_HPP
+#define MGL_INSTANCING_HPP
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "./mglMesh.hpp"
+#include "./mglStreamBuffer.hpp"
+
+namespace mgl {
+
+class InstanceBuffer;
+
+///////////////////////////////////////////////////////////////// InstanceBuffer
+
+// Gathers the model matrix and color of every instance of a mesh and draws
+// them with glDrawElementsInstancedBaseVertex. The instances are written to a
+// StreamBuffer and read by the shader as INSTANCE_MATRIX_ATTRIBUTE and
+// INSTANCE_COLOR_ATTRIBUTE (Mesh::INSTANCE_MATRIX and Mesh::INSTANCE_COLOR,
+// see cube-instanced-vs.glsl). More instances than fit in half a stream frame
+// are drawn in several calls.
+
+struct InstanceData {
+  glm::mat4 modelMatrix;
+  glm::vec4 color;
+};
+
+class InstanceBuffer {
+public:
+  explicit InstanceBuffer(StreamBuffer *stream);
+
+  void add(const glm::mat4 &model_matrix, const glm::vec3 &color);
+  void clear();
+  size_t size() const;
+  // Draws all instances with the bound shader; the instances are kept.
+  void draw(Mesh *mesh);
+
+private:
+  StreamBuffer *Stream;
+  std::vector<InstanceData> Instances;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
+
+#endif /* MGL_INSTANCING_HPP */
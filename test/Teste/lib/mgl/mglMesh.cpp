@@ -8,10 +8,38 @@
 
 #include "./mglMesh.hpp"
 
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <glm/gtc/packing.hpp>
 #include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "./mglConventions.hpp"
+#include "./mglMeshArena.hpp"
+#include "./mglMeshOptimizer.hpp"
+#include "./mglState.hpp"
+
+#ifdef _WIN32
+#include <direct.h>
+#define MGL_MKDIR(dir) _mkdir(dir)
+#else
+#define MGL_MKDIR(dir) mkdir(dir, 0755)
+#endif
 
 namespace mgl {
 
+#ifdef DEBUG
+// Meshes may load on several threads at once (see MeshLoader).
+static std::mutex DebugOutput;
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 
 Mesh::Mesh() {
@@ -19,7 +47,16 @@ Mesh::Mesh() {
   TexcoordsLoaded = false;
   TangentsAndBitangentsLoaded = false;
   VaoId = -1;
+  Arena = nullptr;
+  Allocation = nullptr;
   AssimpFlags = aiProcess_Triangulate;
+  ByteIndices = false;
+  Optimize = false;
+  Raycast = false;
+  Layout = SEPARATE;
+  PositionFmt = POSITION_FLOAT;
+  DirectionFmt = DIRECTION_FLOAT;
+  TexcoordFmt = TEXCOORD_FLOAT;
 }
 
 Mesh::~Mesh() { destroyBufferObjects(); }
@@ -44,15 +81,93 @@ void Mesh::calculateTangentSpace() {
 
 void Mesh::flipUVs() { AssimpFlags |= aiProcess_FlipUVs; }
 
+void Mesh::allowByteIndices() { ByteIndices = true; }
+
+void Mesh::optimize() { Optimize = true; }
+
+void Mesh::enableRaycast() { Raycast = true; }
+
+void Mesh::setCacheDirectory(const std::string &directory) {
+  CacheDirectory = directory;
+}
+
+void Mesh::setVertexLayout(VertexLayout layout) { Layout = layout; }
+
+Mesh::VertexLayout Mesh::getVertexLayout() { return Layout; }
+
+void Mesh::setPositionFormat(PositionFormat format) { PositionFmt = format; }
+
+void Mesh::setDirectionFormat(DirectionFormat format) {
+  DirectionFmt = format;
+}
+
+void Mesh::setTexcoordFormat(TexcoordFormat format) { TexcoordFmt = format; }
+
+void Mesh::setArena(MeshArena *arena) { Arena = arena; }
+
 bool Mesh::hasNormals() { return NormalsLoaded; }
 
 bool Mesh::hasTexcoords() { return TexcoordsLoaded; }
 
 bool Mesh::hasTangentsAndBitangents() { return TangentsAndBitangentsLoaded; }
 
+const Mesh::VertexDecode &Mesh::getVertexDecode() const { return Decode; }
+
+const Mesh::QuantizationError &Mesh::getQuantizationError() const {
+  return QuantError;
+}
+
+const Mesh::OptimizationReport &Mesh::getOptimizationReport() const {
+  return OptReport;
+}
+
+const BoundingBox &Mesh::getBoundingBox() const { return Box; }
+
+const BoundingSphere &Mesh::getBoundingSphere() const { return Sphere; }
+
+size_t Mesh::getSubmeshCount() const { return Meshes.size(); }
+
+const BoundingBox &Mesh::getSubmeshBoundingBox(size_t submesh) const {
+  return Meshes[submesh].box;
+}
+
+const BoundingSphere &Mesh::getSubmeshBoundingSphere(size_t submesh) const {
+  return Meshes[submesh].sphere;
+}
+
+bool Mesh::raycast(const Ray &ray, Bvh::Hit &hit) const {
+  hit = Bvh::Hit();
+  if (!Raycast) {
+    const float distance = intersect(ray, Box);
+    if (distance < 0.0f) {
+      return false;
+    }
+    hit.distance = distance;
+    return true;
+  }
+  const glm::vec3 *triangles = Triangles.data();
+  return TriangleBvh.raycast(
+      ray, hit, [triangles](uint32_t triangle, const Ray &r) {
+        const glm::vec3 *corners = triangles + 3 * triangle;
+        return intersect(r, corners[0], corners[1], corners[2]);
+      });
+}
+
+const std::vector<glm::vec3> &Mesh::getTriangles() const { return Triangles; }
+
+Mesh::MemoryReport Mesh::getMemoryReport() const {
+  MemoryReport report;
+  for (const VertexStream &stream : Streams) {
+    report.vertexBytes += stream.data.size();
+  }
+  report.indexBytes = IndexData.size();
+  report.unpackedIndexBytes = sizeof(unsigned int) * Indices.size();
+  return report;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
-void Mesh::processMesh(const aiMesh *mesh) {
+void Mesh::processMesh(const aiMesh *mesh, MeshData &data) {
   NormalsLoaded = mesh->HasNormals();
   // Check if mesh has texture coordinates in the primary (0th) UV channel
   TexcoordsLoaded = mesh->HasTextureCoords(0);
@@ -87,6 +202,16 @@ void Mesh::processMesh(const aiMesh *mesh) {
     Indices.push_back(face.mIndices[1]);
     Indices.push_back(face.mIndices[2]);
   }
+  // Vertex optimization only reorders the vertices, so bounds stay valid.
+  // A submesh without vertices keeps empty bounds; baseVertex is then one
+  // past the end of Positions.
+  if (mesh->mNumVertices == 0) {
+    return;
+  }
+  data.box = BoundingBox::fromPoints(&Positions[data.baseVertex],
+                                     mesh->mNumVertices);
+  data.sphere = BoundingSphere::fromPoints(&Positions[data.baseVertex],
+                                           mesh->mNumVertices);
 }
 
 void Mesh::clear() {
@@ -99,6 +224,13 @@ void Mesh::clear() {
 #endif
   Indices.clear();
   Meshes.clear();
+  Box = BoundingBox();
+  Sphere = BoundingSphere();
+  TriangleBvh.clear();
+  Triangles.clear();
+  Streams.clear();
+  IndexData.clear();
+  OptReport = OptimizationReport();
 }
 
 void Mesh::processScene(const aiScene *scene) {
@@ -120,92 +252,780 @@ void Mesh::processScene(const aiScene *scene) {
   Indices.reserve(n_indices);
 
   for (unsigned int i = 0; i < Meshes.size(); i++) {
-    processMesh(scene->mMeshes[i]);
+    processMesh(scene->mMeshes[i], Meshes[i]);
   }
 
 #ifdef DEBUG
+  std::lock_guard<std::mutex> lock(DebugOutput);
   std::cout << "Loaded " << Meshes.size() << " mesh(es) [" << n_vertices
             << " vertices, " << n_indices << " indices, " << n_indices / 3
             << " triangles]" << std::endl;
 #endif
 }
 
-void Mesh::create(const std::string &filename) {
-  clear();
-  Assimp::Importer importer;
+void Mesh::optimizeMeshes() {
+  size_t n_triangles = 0;
+  OptReport = OptimizationReport();
+  for (size_t i = 0; i < Meshes.size(); i++) {
+    const MeshData &mesh = Meshes[i];
+    const size_t end_vertex = (i + 1 < Meshes.size())
+                                  ? Meshes[i + 1].baseVertex
+                                  : Positions.size();
+    const size_t n_vertices = end_vertex - mesh.baseVertex;
+    if (n_vertices == 0) {
+      continue;
+    }
+    std::vector<unsigned int> indices(
+        Indices.begin() + mesh.baseIndex,
+        Indices.begin() + mesh.baseIndex + mesh.nIndices);
+
+    const VertexCacheStats before = analyzeVertexCache(indices, n_vertices);
+    optimizeVertexCache(indices, n_vertices);
+    optimizeOverdraw(indices, &Positions[mesh.baseVertex], n_vertices);
+    std::vector<unsigned int> remap;
+    optimizeVertexFetch(indices, n_vertices, remap);
+    const VertexCacheStats after = analyzeVertexCache(indices, n_vertices);
+
+    std::copy(indices.begin(), indices.end(), Indices.begin() + mesh.baseIndex);
+    remapVertices(&Positions[mesh.baseVertex], remap);
+    if (NormalsLoaded) {
+      remapVertices(&Normals[mesh.baseVertex], remap);
+    }
+    if (TexcoordsLoaded) {
+      remapVertices(&Texcoords[mesh.baseVertex], remap);
+    }
+    if (TangentsAndBitangentsLoaded) {
+      remapVertices(&Tangents[mesh.baseVertex], remap);
+#ifdef CREATE_BITANGENT
+      remapVertices(&Bitangents[mesh.baseVertex], remap);
+#endif
+    }
+
+    // Weight each submesh by its triangle count.
+    const float weight = static_cast<float>(mesh.nIndices / 3);
+    OptReport.acmrBefore += before.acmr * weight;
+    OptReport.acmrAfter += after.acmr * weight;
+    OptReport.atvrBefore += before.atvr * weight;
+    OptReport.atvrAfter += after.atvr * weight;
+    n_triangles += mesh.nIndices / 3;
+  }
+  if (n_triangles > 0) {
+    OptReport.acmrBefore /= n_triangles;
+    OptReport.acmrAfter /= n_triangles;
+    OptReport.atvrBefore /= n_triangles;
+    OptReport.atvrAfter /= n_triangles;
+  }
+
+#ifdef DEBUG
+  std::lock_guard<std::mutex> lock(DebugOutput);
+  std::cout << "Optimized vertex cache [ACMR " << OptReport.acmrBefore
+            << " -> " << OptReport.acmrAfter << ", ATVR "
+            << OptReport.atvrBefore << " -> " << OptReport.atvrAfter << "]"
+            << std::endl;
+#endif
+}
+
+void Mesh::computeBounds() {
+  Box = BoundingBox();
+  for (const MeshData &mesh : Meshes) {
+    Box.add(mesh.box);
+  }
+  Sphere = BoundingSphere::fromPoints(Positions.data(), Positions.size());
+}
+
+void Mesh::buildTriangleBvh() {
+  Triangles.resize(Indices.size());
+  std::vector<BoundingBox> boxes(Indices.size() / 3);
+  for (const MeshData &mesh : Meshes) {
+    for (unsigned int i = 0; i < mesh.nIndices; i++) {
+      const unsigned int k = mesh.baseIndex + i;
+      Triangles[k] = Positions[mesh.baseVertex + Indices[k]];
+      boxes[k / 3].add(Triangles[k]);
+    }
+  }
+  TriangleBvh.build(boxes.data(), boxes.size());
+}
+
+bool Mesh::import(const std::string &filename, Assimp::Importer &importer) {
   const aiScene *scene = importer.ReadFile(filename, AssimpFlags);
   if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE ||
       !scene->mRootNode) {
-    std::cerr << "Error while loading:" << importer.GetErrorString()
-              << std::endl;
-    exit(EXIT_FAILURE);
+    LoadError = importer.GetErrorString();
+    importer.FreeScene();
+    return false;
   }
 
 #ifdef DEBUG
-  std::cout << "Processing [" << filename << "]" << std::endl;
+  {
+    std::lock_guard<std::mutex> lock(DebugOutput);
+    std::cout << "Processing [" << filename << "]" << std::endl;
+  }
 #endif
 
   processScene(scene);
-  createBufferObjects();
+  importer.FreeScene();
+  if (Optimize) {
+    optimizeMeshes();
+  }
+  return true;
 }
 
-void Mesh::createBufferObjects() {
-  GLuint boId[6];
+void Mesh::load(const std::string &filename) {
+  Assimp::Importer importer;
+  if (!load(filename, importer)) {
+    std::cerr << "Error while loading:" << LoadError << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
 
-  glGenVertexArrays(1, &VaoId);
-  glBindVertexArray(VaoId);
-  {
-    glGenBuffers(6, boId);
+bool Mesh::load(const std::string &filename, Assimp::Importer &importer) {
+  clear();
+  Filename = filename;
+  LoadError.clear();
+  if (CacheDirectory.empty()) {
+    if (!import(filename, importer)) {
+      clear();
+      return false;
+    }
+  } else if (!readCache(filename)) {
+    clear();
+    if (!import(filename, importer)) {
+      clear();
+      return false;
+    }
+    writeCache(filename);
+  }
+  computeBounds();
+  if (Raycast) {
+    buildTriangleBvh();
+  }
+  buildVertexStreams();
+  buildIndexBuffer();
+  return true;
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, boId[POSITION]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(Positions[0]) * Positions.size(),
-                 &Positions[0], GL_STATIC_DRAW);
-    glEnableVertexAttribArray(POSITION);
-    glVertexAttribPointer(POSITION, 3, GL_FLOAT, GL_FALSE, 0, 0);
+const std::string &Mesh::getLoadError() const { return LoadError; }
 
-    if (NormalsLoaded) {
-      glBindBuffer(GL_ARRAY_BUFFER, boId[NORMAL]);
-      glBufferData(GL_ARRAY_BUFFER, sizeof(Normals[0]) * Normals.size(),
-                   &Normals[0], GL_STATIC_DRAW);
-      glEnableVertexAttribArray(NORMAL);
-      glVertexAttribPointer(NORMAL, 3, GL_FLOAT, GL_FALSE, 0, 0);
+void Mesh::upload() {
+  if (Arena) {
+    Allocation = Arena->allocate(Streams, IndexData);
+  } else {
+    createBufferObjects();
+  }
+#ifdef DEBUG
+  const MemoryReport report = getMemoryReport();
+  std::cout << "Memory [" << Filename << "]: " << report.vertexBytes
+            << " vertex bytes, " << report.indexBytes << " index bytes ("
+            << report.unpackedIndexBytes << " as 32-bit indices)" << std::endl;
+#endif
+}
+
+void Mesh::create(const std::string &filename) {
+  load(filename);
+  upload();
+}
+
+////////////////////////////////////////////////////////////////////////// CACHE
+
+// Cache files start with this header, followed by the source path, the
+// MeshData table and the flattened vertex and index arrays. Bump the version
+// whenever the layout of the file or of the processed arrays changes. The
+// file name hashes the path with the settings that change the stored arrays
+// (Assimp flags and optimization), so a model keeps one file per import.
+
+static const char CACHE_MAGIC[4] = {'M', 'G', 'L', 'M'};
+static const uint32_t CACHE_VERSION = 6;
+
+enum CacheAttributes : uint32_t {
+  CACHE_NORMALS = 1 << 0,
+  CACHE_TEXCOORDS = 1 << 1,
+  CACHE_TANGENTS = 1 << 2,
+  CACHE_BITANGENTS = 1 << 3
+};
+
+struct CacheHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t assimpFlags;
+  uint32_t optimized;
+  uint32_t attributes;
+  uint32_t reserved;  // zero, keeps sourceTime aligned without padding
+  int64_t sourceTime;
+  uint64_t sourceSize;
+  uint32_t pathLength;
+  uint32_t nMeshes;
+  uint32_t nVertices;
+  uint32_t nIndices;
+  float acmrBefore, acmrAfter;  // OptimizationReport of the stored arrays
+  float atvrBefore, atvrAfter;
+};
+static_assert(sizeof(CacheHeader) == 72, "CacheHeader must have no padding");
+
+static uint64_t hashBytes(const void *data, size_t size,
+                          uint64_t hash = 14695981039346656037ull) {
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < size; i++) {  // FNV-1a
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+static bool statSource(const std::string &filename, CacheHeader &header) {
+  struct stat info;
+  if (stat(filename.c_str(), &info) != 0) {
+    return false;
+  }
+  header.sourceTime = static_cast<int64_t>(info.st_mtime);
+  header.sourceSize = static_cast<uint64_t>(info.st_size);
+  return true;
+}
+
+template <typename T>
+static void readArray(std::ifstream &ifile, std::vector<T> &v, size_t n) {
+  v.resize(n);
+  if (n > 0) {
+    ifile.read(reinterpret_cast<char *>(v.data()), sizeof(T) * n);
+  }
+}
+
+template <typename T>
+static void writeArray(std::ofstream &ofile, const std::vector<T> &v) {
+  if (!v.empty()) {
+    ofile.write(reinterpret_cast<const char *>(v.data()), sizeof(T) * v.size());
+  }
+}
+
+std::string Mesh::getCacheFilename(const std::string &filename) {
+  // Layout and vertex formats are applied after reading the cache, so they
+  // are left out: every way of packing a model shares its file.
+  const uint32_t key[] = {AssimpFlags, static_cast<uint32_t>(Optimize)};
+  const uint64_t hash = hashBytes(key, sizeof(key),
+                                  hashBytes(filename.data(), filename.size()));
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.mesh",
+           static_cast<unsigned long long>(hash));
+  return CacheDirectory + "/" + name;
+}
+
+bool Mesh::readCache(const std::string &filename) {
+  CacheHeader expected;
+  if (!statSource(filename, expected)) {
+    return false;
+  }
+  std::ifstream ifile(getCacheFilename(filename),
+                      std::ios::binary | std::ios::ate);
+  if (!ifile.is_open()) {
+    return false;
+  }
+  const uint64_t file_size = static_cast<uint64_t>(ifile.tellg());
+  ifile.seekg(0);
+  CacheHeader header;
+  ifile.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!ifile.good() ||
+      std::string(header.magic, 4) != std::string(CACHE_MAGIC, 4) ||
+      header.version != CACHE_VERSION || header.assimpFlags != AssimpFlags ||
+      header.optimized != static_cast<uint32_t>(Optimize) ||
+      header.sourceTime != expected.sourceTime ||
+      header.sourceSize != expected.sourceSize ||
+      header.pathLength != filename.size()) {
+    return false;
+  }
+  std::string path(header.pathLength, '\0');
+  ifile.read(&path[0], header.pathLength);
+  if (path != filename) {
+    return false;
+  }
+#ifndef CREATE_BITANGENT
+  if (header.attributes & CACHE_BITANGENTS) {
+    return false;
+  }
+#endif
+  // Check the counts against the file before allocating anything.
+  const uint32_t attributes = header.attributes;
+  const uint64_t vertex_bytes =
+      sizeof(glm::vec3) +
+      ((attributes & CACHE_NORMALS) ? sizeof(glm::vec3) : 0) +
+      ((attributes & CACHE_TEXCOORDS) ? sizeof(glm::vec2) : 0) +
+      ((attributes & CACHE_TANGENTS) ? sizeof(glm::vec3) : 0) +
+      ((attributes & CACHE_BITANGENTS) ? sizeof(glm::vec3) : 0);
+  const uint64_t expected_size =
+      sizeof(header) + header.pathLength +
+      uint64_t(header.nMeshes) * sizeof(MeshData) +
+      uint64_t(header.nVertices) * vertex_bytes +
+      uint64_t(header.nIndices) * sizeof(unsigned int);
+  if (file_size != expected_size) {
+    return false;
+  }
+
+  NormalsLoaded = (header.attributes & CACHE_NORMALS) != 0;
+  TexcoordsLoaded = (header.attributes & CACHE_TEXCOORDS) != 0;
+  TangentsAndBitangentsLoaded = (header.attributes & CACHE_TANGENTS) != 0;
+  const size_t n = header.nVertices;
+
+  readArray(ifile, Meshes, header.nMeshes);
+  readArray(ifile, Positions, n);
+  readArray(ifile, Normals, NormalsLoaded ? n : 0);
+  readArray(ifile, Texcoords, TexcoordsLoaded ? n : 0);
+  readArray(ifile, Tangents, TangentsAndBitangentsLoaded ? n : 0);
+#ifdef CREATE_BITANGENT
+  readArray(ifile, Bitangents,
+            (header.attributes & CACHE_BITANGENTS) ? n : 0);
+  if (TangentsAndBitangentsLoaded && Bitangents.empty()) {
+    return false;
+  }
+#endif
+  readArray(ifile, Indices, header.nIndices);
+  if (!ifile.good()) {
+    return false;
+  }
+  OptReport.acmrBefore = header.acmrBefore;
+  OptReport.acmrAfter = header.acmrAfter;
+  OptReport.atvrBefore = header.atvrBefore;
+  OptReport.atvrAfter = header.atvrAfter;
+
+#ifdef DEBUG
+  std::lock_guard<std::mutex> lock(DebugOutput);
+  std::cout << "Loaded [" << filename << "] from cache: " << Meshes.size()
+            << " mesh(es) [" << Positions.size() << " vertices, "
+            << Indices.size() << " indices]" << std::endl;
+#endif
+  return true;
+}
+
+void Mesh::writeCache(const std::string &filename) {
+  CacheHeader header = {};
+  if (!statSource(filename, header)) {
+    return;
+  }
+  std::copy(CACHE_MAGIC, CACHE_MAGIC + 4, header.magic);
+  header.version = CACHE_VERSION;
+  header.assimpFlags = AssimpFlags;
+  header.optimized = Optimize;
+  // Only arrays covering every vertex are stored, as readCache() expects.
+  const size_t n = Positions.size();
+  header.attributes = 0;
+  if (NormalsLoaded && Normals.size() == n) {
+    header.attributes |= CACHE_NORMALS;
+  }
+  if (TexcoordsLoaded && Texcoords.size() == n) {
+    header.attributes |= CACHE_TEXCOORDS;
+  }
+  if (TangentsAndBitangentsLoaded && Tangents.size() == n) {
+    header.attributes |= CACHE_TANGENTS;
+  }
+#ifdef CREATE_BITANGENT
+  if (TangentsAndBitangentsLoaded && Bitangents.size() == n) {
+    header.attributes |= CACHE_BITANGENTS;
+  }
+#endif
+  header.pathLength = static_cast<uint32_t>(filename.size());
+  header.nMeshes = static_cast<uint32_t>(Meshes.size());
+  header.nVertices = static_cast<uint32_t>(n);
+  header.nIndices = static_cast<uint32_t>(Indices.size());
+  header.acmrBefore = OptReport.acmrBefore;
+  header.acmrAfter = OptReport.acmrAfter;
+  header.atvrBefore = OptReport.atvrBefore;
+  header.atvrAfter = OptReport.atvrAfter;
+
+  MGL_MKDIR(CacheDirectory.c_str());
+  // Written under a name of its own and renamed into place, so that loads of
+  // the same file on other threads never see a partial cache file.
+  const std::string cachefile = getCacheFilename(filename);
+  const std::string tempfile =
+      cachefile + "." +
+      std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) +
+      ".tmp";
+  std::ofstream ofile(tempfile, std::ios::binary | std::ios::trunc);
+  if (!ofile.is_open()) {
+    std::cerr << "[WARNING] Failed to write mesh cache: " << cachefile
+              << std::endl;
+    return;
+  }
+  ofile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  ofile.write(filename.data(), filename.size());
+  writeArray(ofile, Meshes);
+  writeArray(ofile, Positions);
+  if (header.attributes & CACHE_NORMALS) {
+    writeArray(ofile, Normals);
+  }
+  if (header.attributes & CACHE_TEXCOORDS) {
+    writeArray(ofile, Texcoords);
+  }
+  if (header.attributes & CACHE_TANGENTS) {
+    writeArray(ofile, Tangents);
+  }
+#ifdef CREATE_BITANGENT
+  if (header.attributes & CACHE_BITANGENTS) {
+    writeArray(ofile, Bitangents);
+  }
+#endif
+  writeArray(ofile, Indices);
+  ofile.close();
+  if (!ofile) {
+    std::remove(tempfile.c_str());
+    return;
+  }
+  if (std::rename(tempfile.c_str(), cachefile.c_str()) != 0) {
+    // rename() does not replace an existing file on Windows.
+    std::remove(cachefile.c_str());
+    if (std::rename(tempfile.c_str(), cachefile.c_str()) != 0) {
+      std::remove(tempfile.c_str());
     }
+  }
+}
 
-    if (TexcoordsLoaded) {
-      glBindBuffer(GL_ARRAY_BUFFER, boId[TEXCOORD]);
-      glBufferData(GL_ARRAY_BUFFER, sizeof(Texcoords[0]) * Texcoords.size(),
-                   &Texcoords[0], GL_STATIC_DRAW);
-      glEnableVertexAttribArray(TEXCOORD);
-      glVertexAttribPointer(TEXCOORD, 2, GL_FLOAT, GL_FALSE, 0, 0);
+/////////////////////////////////////////////////////////////////////// BUFFERS
+
+struct AttributeSource {
+  GLuint index;
+  GLint size;
+  GLenum type;
+  GLboolean normalized;
+  GLuint bytes;
+  const unsigned char *data;
+};
+
+template <typename T>
+static AttributeSource makeSource(GLuint index, const std::vector<T> &v) {
+  return {index, static_cast<GLint>(sizeof(T) / sizeof(float)), GL_FLOAT,
+          GL_FALSE, static_cast<GLuint>(sizeof(T)),
+          reinterpret_cast<const unsigned char *>(v.data())};
+}
+
+template <typename T>
+static void appendBytes(std::vector<unsigned char> &out, const T &value) {
+  const unsigned char *p = reinterpret_cast<const unsigned char *>(&value);
+  out.insert(out.end(), p, p + sizeof(T));
+}
+
+static glm::vec2 encodeOctahedral(const glm::vec3 &n) {
+  const float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+  if (l1 == 0.0f) {
+    return glm::vec2(0.0f);
+  }
+  const glm::vec3 v = n / l1;
+  if (v.z >= 0.0f) {
+    return glm::vec2(v.x, v.y);
+  }
+  return glm::vec2((1.0f - std::abs(v.y)) * (v.x >= 0.0f ? 1.0f : -1.0f),
+                   (1.0f - std::abs(v.x)) * (v.y >= 0.0f ? 1.0f : -1.0f));
+}
+
+static glm::vec3 decodeOctahedral(const glm::vec2 &e) {
+  glm::vec3 v(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+  if (v.z < 0.0f) {
+    v = glm::vec3((1.0f - std::abs(e.y)) * (e.x >= 0.0f ? 1.0f : -1.0f),
+                  (1.0f - std::abs(e.x)) * (e.y >= 0.0f ? 1.0f : -1.0f), v.z);
+  }
+  return glm::normalize(v);
+}
+
+static float angleBetween(const glm::vec3 &a, const glm::vec3 &b) {
+  // atan2 keeps precision for the tiny angles acos(dot) would round to zero
+  return std::atan2(glm::length(glm::cross(a, b)), glm::dot(a, b));
+}
+
+static AttributeSource encodePositions(const std::vector<glm::vec3> &positions,
+                                       Mesh::PositionFormat format,
+                                       Mesh::VertexDecode &decode,
+                                       float &error,
+                                       std::vector<unsigned char> &out) {
+  glm::vec3 lo(0.0f), hi(0.0f);
+  if (!positions.empty()) {
+    lo = hi = positions[0];
+  }
+  for (const glm::vec3 &p : positions) {
+    lo = glm::min(lo, p);
+    hi = glm::max(hi, p);
+  }
+  decode.positionBias = (lo + hi) * 0.5f;
+  decode.positionScale = glm::max((hi - lo) * 0.5f, glm::vec3(1e-20f));
+  decode.flags |= DECODE_POSITION;
+
+  out.reserve(positions.size() * 8);
+  error = 0.0f;
+  for (const glm::vec3 &p : positions) {
+    const glm::vec3 q = (p - decode.positionBias) / decode.positionScale;
+    glm::vec3 decoded;
+    if (format == Mesh::POSITION_HALF) {
+      const glm::u16vec4 h(glm::packHalf1x16(q.x), glm::packHalf1x16(q.y),
+                           glm::packHalf1x16(q.z), glm::packHalf1x16(1.0f));
+      appendBytes(out, h);
+      decoded = glm::vec3(glm::unpackHalf1x16(h.x), glm::unpackHalf1x16(h.y),
+                          glm::unpackHalf1x16(h.z));
+    } else {
+      const glm::u16vec4 s(glm::packSnorm1x16(q.x), glm::packSnorm1x16(q.y),
+                           glm::packSnorm1x16(q.z), glm::packSnorm1x16(1.0f));
+      appendBytes(out, s);
+      decoded = glm::vec3(glm::unpackSnorm1x16(s.x), glm::unpackSnorm1x16(s.y),
+                          glm::unpackSnorm1x16(s.z));
     }
+    decoded = decoded * decode.positionScale + decode.positionBias;
+    error = std::max(error, glm::length(decoded - p));
+  }
+  if (format == Mesh::POSITION_HALF) {
+    return {Mesh::POSITION, 3, GL_HALF_FLOAT, GL_FALSE, 8, out.data()};
+  }
+  return {Mesh::POSITION, 3, GL_SHORT, GL_TRUE, 8, out.data()};
+}
 
-    if (TangentsAndBitangentsLoaded) {
-      glBindBuffer(GL_ARRAY_BUFFER, boId[TANGENT]);
-      glBufferData(GL_ARRAY_BUFFER, sizeof(Tangents[0]) * Tangents.size(),
-                   &Tangents[0], GL_STATIC_DRAW);
-      glEnableVertexAttribArray(TANGENT);
-      glVertexAttribPointer(TANGENT, 3, GL_FLOAT, GL_FALSE, 0, 0);
+static AttributeSource encodeDirections(GLuint index,
+                                        const std::vector<glm::vec3> &dirs,
+                                        Mesh::DirectionFormat format,
+                                        float &error,
+                                        std::vector<unsigned char> &out) {
+  out.reserve(dirs.size() * 4);
+  for (const glm::vec3 &d : dirs) {
+    glm::vec3 decoded;
+    if (format == Mesh::DIRECTION_OCTAHEDRAL_SNORM16) {
+      const glm::vec2 e = encodeOctahedral(d);
+      const glm::u16vec2 s(glm::packSnorm1x16(e.x), glm::packSnorm1x16(e.y));
+      appendBytes(out, s);
+      decoded = decodeOctahedral(glm::vec2(glm::unpackSnorm1x16(s.x),
+                                           glm::unpackSnorm1x16(s.y)));
+    } else {
+      const glm::uint32 p = glm::packSnorm3x10_1x2(glm::vec4(d, 0.0f));
+      appendBytes(out, p);
+      decoded = glm::vec3(glm::unpackSnorm3x10_1x2(p));
+    }
+    error = std::max(error, angleBetween(d, decoded));
+  }
+  if (format == Mesh::DIRECTION_OCTAHEDRAL_SNORM16) {
+    return {index, 2, GL_SHORT, GL_TRUE, 4, out.data()};
+  }
+  return {index, 4, GL_INT_2_10_10_10_REV, GL_TRUE, 4, out.data()};
+}
+
+static AttributeSource encodeTexcoords(const std::vector<glm::vec2> &texcoords,
+                                       Mesh::VertexDecode &decode,
+                                       float &error,
+                                       std::vector<unsigned char> &out) {
+  glm::vec2 lo(0.0f), hi(0.0f);
+  if (!texcoords.empty()) {
+    lo = hi = texcoords[0];
+  }
+  for (const glm::vec2 &t : texcoords) {
+    lo = glm::min(lo, t);
+    hi = glm::max(hi, t);
+  }
+  decode.texcoordBias = lo;
+  decode.texcoordScale = glm::max(hi - lo, glm::vec2(1e-20f));
+  decode.flags |= DECODE_TEXCOORD;
+
+  out.reserve(texcoords.size() * 4);
+  error = 0.0f;
+  for (const glm::vec2 &t : texcoords) {
+    const glm::vec2 q = (t - decode.texcoordBias) / decode.texcoordScale;
+    const glm::u16vec2 u(glm::packUnorm1x16(q.x), glm::packUnorm1x16(q.y));
+    appendBytes(out, u);
+    const glm::vec2 decoded =
+        glm::vec2(glm::unpackUnorm1x16(u.x), glm::unpackUnorm1x16(u.y)) *
+            decode.texcoordScale +
+        decode.texcoordBias;
+    const glm::vec2 d = glm::abs(decoded - t);
+    error = std::max(error, std::max(d.x, d.y));
+  }
+  return {Mesh::TEXCOORD, 2, GL_UNSIGNED_SHORT, GL_TRUE, 4, out.data()};
+}
 
+void Mesh::buildVertexStreams() {
+  Decode = VertexDecode();
+  QuantError = QuantizationError();
+  std::vector<unsigned char> encoded[5];
+  std::vector<AttributeSource> sources;
+
+  if (PositionFmt == POSITION_FLOAT) {
+    sources.push_back(makeSource(POSITION, Positions));
+  } else {
+    sources.push_back(encodePositions(Positions, PositionFmt, Decode,
+                                      QuantError.position, encoded[0]));
+  }
+  if (NormalsLoaded) {
+    if (DirectionFmt == DIRECTION_FLOAT) {
+      sources.push_back(makeSource(NORMAL, Normals));
+    } else {
+      sources.push_back(encodeDirections(NORMAL, Normals, DirectionFmt,
+                                         QuantError.direction, encoded[1]));
+    }
+  }
+  if (TexcoordsLoaded) {
+    if (TexcoordFmt == TEXCOORD_FLOAT) {
+      sources.push_back(makeSource(TEXCOORD, Texcoords));
+    } else {
+      sources.push_back(encodeTexcoords(Texcoords, Decode, QuantError.texcoord,
+                                        encoded[2]));
+    }
+  }
+  if (TangentsAndBitangentsLoaded) {
+    if (DirectionFmt == DIRECTION_FLOAT) {
+      sources.push_back(makeSource(TANGENT, Tangents));
+#ifdef CREATE_BITANGENT
+      sources.push_back(makeSource(BITANGENT, Bitangents));
+#endif
+    } else {
+      sources.push_back(encodeDirections(TANGENT, Tangents, DirectionFmt,
+                                         QuantError.direction, encoded[3]));
 #ifdef CREATE_BITANGENT
-      glBindBuffer(GL_ARRAY_BUFFER, boId[BITANGENT]);
-      glBufferData(GL_ARRAY_BUFFER, sizeof(Bitangents[0]) * Bitangents.size(),
-                   &Bitangents[0], GL_STATIC_DRAW);
-      glEnableVertexAttribArray(BITANGENT);
-      glVertexAttribPointer(BITANGENT, 3, GL_FLOAT, GL_FALSE, 0, 0);
+      sources.push_back(encodeDirections(BITANGENT, Bitangents, DirectionFmt,
+                                         QuantError.direction, encoded[4]));
 #endif
     }
+  }
+  if (DirectionFmt == DIRECTION_OCTAHEDRAL_SNORM16) {
+    Decode.flags |= DECODE_OCTAHEDRAL;
+  }
+
+  // Assign each attribute to a stream according to the layout.
+  std::vector<size_t> stream_of(sources.size());
+  size_t n_streams = 0;
+  for (size_t i = 0; i < sources.size(); i++) {
+    switch (Layout) {
+    case SEPARATE:
+      stream_of[i] = i;
+      break;
+    case INTERLEAVED:
+      stream_of[i] = 0;
+      break;
+    case SPLIT_POSITION:
+      stream_of[i] = (sources[i].index == POSITION) ? 0 : 1;
+      break;
+    }
+    n_streams = std::max(n_streams, stream_of[i] + 1);
+  }
+
+  Streams.clear();
+  Streams.resize(n_streams);
+  for (size_t i = 0; i < sources.size(); i++) {
+    VertexStream &stream = Streams[stream_of[i]];
+    const AttributeSource &src = sources[i];
+    stream.attributes.push_back({src.index, src.size, src.type,
+                                 src.normalized,
+                                 static_cast<GLuint>(stream.stride)});
+    stream.stride += src.bytes;
+  }
+  for (VertexStream &stream : Streams) {
+    stream.stride = (stream.stride + 3) & ~3;  // keep vertices 4-byte aligned
+  }
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, boId[INDEX]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(Indices[0]) * Indices.size(),
-                 &Indices[0], GL_STATIC_DRAW);
+  const size_t n_vertices = Positions.size();
+  for (VertexStream &stream : Streams) {
+    stream.data.assign(stream.stride * n_vertices, 0);
   }
-  glBindVertexArray(0);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glDeleteBuffers(6, boId);
+  for (size_t i = 0; i < sources.size(); i++) {
+    VertexStream &stream = Streams[stream_of[i]];
+    const AttributeSource &src = sources[i];
+    GLuint offset = 0;
+    for (const VertexAttribute &attribute : stream.attributes) {
+      if (attribute.index == src.index) offset = attribute.offset;
+    }
+    unsigned char *dst = stream.data.data() + offset;
+    for (size_t v = 0; v < n_vertices; v++) {
+      std::copy(src.data + v * src.bytes, src.data + (v + 1) * src.bytes,
+                dst + v * stream.stride);
+    }
+  }
+
+#ifdef DEBUG
+  if (Decode.flags != 0 || DirectionFmt != DIRECTION_FLOAT) {
+    size_t bytes = 0;
+    for (const VertexStream &stream : Streams) bytes += stream.data.size();
+    std::lock_guard<std::mutex> lock(DebugOutput);
+    std::cout << "Quantized " << n_vertices << " vertices into " << bytes
+              << " bytes [max error: position " << QuantError.position
+              << ", direction " << QuantError.direction << " rad, texcoord "
+              << QuantError.texcoord << "]" << std::endl;
+  }
+#endif
+}
+
+template <typename T>
+static void packIndices(std::vector<unsigned char> &out,
+                        const unsigned int *indices, unsigned int n) {
+  for (unsigned int i = 0; i < n; i++) {
+    const T index = static_cast<T>(indices[i]);
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(&index);
+    out.insert(out.end(), p, p + sizeof(T));
+  }
+}
+
+void Mesh::buildIndexBuffer() {
+  IndexData.clear();
+  for (MeshData &mesh : Meshes) {
+    const unsigned int *indices = Indices.data() + mesh.baseIndex;
+    unsigned int max_index = 0;
+    for (unsigned int i = 0; i < mesh.nIndices; i++) {
+      max_index = std::max(max_index, indices[i]);
+    }
+    size_t size;
+    if (ByteIndices && max_index <= 0xFF) {
+      mesh.indexType = GL_UNSIGNED_BYTE;
+      size = sizeof(GLubyte);
+    } else if (max_index <= 0xFFFF) {
+      mesh.indexType = GL_UNSIGNED_SHORT;
+      size = sizeof(GLushort);
+    } else {
+      mesh.indexType = GL_UNSIGNED_INT;
+      size = sizeof(GLuint);
+    }
+    // Index offsets must be a multiple of the index size.
+    IndexData.resize((IndexData.size() + size - 1) / size * size, 0);
+    mesh.indexOffset = static_cast<unsigned int>(IndexData.size());
+    switch (mesh.indexType) {
+    case GL_UNSIGNED_BYTE:
+      packIndices<GLubyte>(IndexData, indices, mesh.nIndices);
+      break;
+    case GL_UNSIGNED_SHORT:
+      packIndices<GLushort>(IndexData, indices, mesh.nIndices);
+      break;
+    default:
+      packIndices<GLuint>(IndexData, indices, mesh.nIndices);
+      break;
+    }
+  }
+}
+
+void Mesh::createBufferObjects() {
+  State &state = State::getInstance();
+  std::vector<GLuint> boId(Streams.size() + 1);
+
+  glGenVertexArrays(1, &VaoId);
+  state.bindVertexArray(VaoId);
+  {
+    glGenBuffers(static_cast<GLsizei>(boId.size()), boId.data());
+
+    for (size_t i = 0; i < Streams.size(); i++) {
+      const VertexStream &stream = Streams[i];
+      state.bindBuffer(GL_ARRAY_BUFFER, boId[i + 1]);
+      glBufferData(GL_ARRAY_BUFFER, stream.data.size(), stream.data.data(),
+                   GL_STATIC_DRAW);
+      for (const VertexAttribute &attribute : stream.attributes) {
+        glEnableVertexAttribArray(attribute.index);
+        glVertexAttribPointer(
+            attribute.index, attribute.size, attribute.type,
+            attribute.normalized, stream.stride,
+            reinterpret_cast<void *>(static_cast<size_t>(attribute.offset)));
+      }
+    }
+
+    state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, boId[INDEX]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, IndexData.size(), IndexData.data(),
+                 GL_STATIC_DRAW);
+  }
+  // Deleting buffers attached to the bound vertex array detaches them, so
+  // unbind it first; the vertex array keeps them alive until it is deleted.
+  state.bindVertexArray(0);
+  state.deleteBuffers(static_cast<GLsizei>(boId.size()), boId.data());
 }
 
 void Mesh::destroyBufferObjects() {
-  glBindVertexArray(VaoId);
+  if (Allocation) {
+    Arena->free(Allocation);
+    Allocation = nullptr;
+    return;
+  }
+  State &state = State::getInstance();
+  state.bindVertexArray(VaoId);
   glDisableVertexAttribArray(POSITION);
   glDisableVertexAttribArray(NORMAL);
   glDisableVertexAttribArray(TEXCOORD);
@@ -213,20 +1033,78 @@ void Mesh::destroyBufferObjects() {
 #ifdef CREATE_BITANGENT
   glDisableVertexAttribArray(BITANGENT);
 #endif
-  glDeleteVertexArrays(1, &VaoId);
-  glBindVertexArray(0);
+  state.deleteVertexArrays(1, &VaoId);
+}
+
+static GLuint indexSize(GLenum type) {
+  switch (type) {
+  case GL_UNSIGNED_BYTE:
+    return sizeof(GLubyte);
+  case GL_UNSIGNED_SHORT:
+    return sizeof(GLushort);
+  default:
+    return sizeof(GLuint);
+  }
+}
+
+GLuint Mesh::getVertexArray() const {
+  return Allocation ? Arena->getVertexArray(Allocation) : VaoId;
+}
+
+void Mesh::bind() {
+  if (Allocation) {
+    Arena->bind(Allocation);
+  } else {
+    State::getInstance().bindVertexArray(VaoId);
+  }
+}
+
+void Mesh::getDrawCommands(std::vector<DrawCommand> &commands) const {
+  const unsigned int index_offset = Allocation ? Allocation->indexOffset : 0;
+  const unsigned int base_vertex = Allocation ? Allocation->baseVertex : 0;
+  for (const MeshData &mesh : Meshes) {
+    commands.push_back(
+        {mesh.nIndices,
+         (index_offset + mesh.indexOffset) / indexSize(mesh.indexType),
+         static_cast<GLint>(base_vertex + mesh.baseVertex), mesh.indexType});
+  }
 }
 
 void Mesh::draw() {
-  glBindVertexArray(VaoId);
+  if (Allocation) {
+    // Arena meshes share one vertex array per format, which stays bound so
+    // that consecutive arena draws need no rebinding.
+    Arena->bind(Allocation);
+    for (MeshData &mesh : Meshes) {
+      glDrawElementsBaseVertex(
+          GL_TRIANGLES, mesh.nIndices, mesh.indexType,
+          reinterpret_cast<void *>(
+              static_cast<size_t>(Allocation->indexOffset + mesh.indexOffset)),
+          Allocation->baseVertex + mesh.baseVertex);
+    }
+    return;
+  }
+  State::getInstance().bindVertexArray(VaoId);
   for (MeshData &mesh : Meshes) {
     glDrawElementsBaseVertex(
-        GL_TRIANGLES, mesh.nIndices, GL_UNSIGNED_INT,
-        reinterpret_cast<void *>((sizeof(unsigned int) * mesh.baseIndex)),
+        GL_TRIANGLES, mesh.nIndices, mesh.indexType,
+        reinterpret_cast<void *>(static_cast<size_t>(mesh.indexOffset)),
         mesh.baseVertex);
     // GLenum mode, GLsizei count, GLenum type, void *indices, GLint basevertex
   }
-  glBindVertexArray(0);
+}
+
+void Mesh::drawInstanced(GLsizei instances) {
+  bind();
+  const unsigned int index_offset = Allocation ? Allocation->indexOffset : 0;
+  const unsigned int base_vertex = Allocation ? Allocation->baseVertex : 0;
+  for (MeshData &mesh : Meshes) {
+    glDrawElementsInstancedBaseVertex(
+        GL_TRIANGLES, mesh.nIndices, mesh.indexType,
+        reinterpret_cast<void *>(
+            static_cast<size_t>(index_offset + mesh.indexOffset)),
+        instances, base_vertex + mesh.baseVertex);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
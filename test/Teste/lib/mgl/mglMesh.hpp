@@ -18,11 +18,15 @@
 #include <string>
 #include <vector>
 
+#include "./mglBounds.hpp"
+#include "./mglBvh.hpp"
 #include "./mglScenegraph.hpp"
 
 namespace mgl {
 
 class Mesh;
+class MeshArena;
+struct MeshArenaAllocation;
 
 #define CREATE_BITANGENT
 
@@ -38,6 +42,75 @@ public:
 #ifdef CREATE_BITANGENT
   static const GLuint BITANGENT = 5;
 #endif
+  // Per-instance attributes (mglInstancing.hpp); the matrix takes 4 slots.
+  static const GLuint INSTANCE_MATRIX = 6;
+  static const GLuint INSTANCE_COLOR = 10;
+
+  // SEPARATE uploads one buffer per attribute, INTERLEAVED packs all
+  // attributes of a vertex together and SPLIT_POSITION keeps positions in
+  // their own stream followed by the remaining attributes interleaved.
+  enum VertexLayout { SEPARATE, INTERLEAVED, SPLIT_POSITION };
+
+  // Packed attribute formats. Quantized positions and texcoords are stored
+  // relative to the mesh bounding box and decoded in the vertex shader with
+  // the scale and bias in VertexDecode (see mglConventions.hpp).
+  enum PositionFormat { POSITION_FLOAT, POSITION_HALF, POSITION_SNORM16 };
+  enum DirectionFormat {
+    DIRECTION_FLOAT,
+    DIRECTION_OCTAHEDRAL_SNORM16,
+    DIRECTION_INT_2_10_10_10
+  };
+  enum TexcoordFormat { TEXCOORD_FLOAT, TEXCOORD_UNORM16 };
+
+  struct VertexDecode {
+    GLint flags = 0;
+    glm::vec3 positionScale = glm::vec3(1.0f);
+    glm::vec3 positionBias = glm::vec3(0.0f);
+    glm::vec2 texcoordScale = glm::vec2(1.0f);
+    glm::vec2 texcoordBias = glm::vec2(0.0f);
+  };
+  // Largest error introduced by quantization: object-space distance for
+  // positions, angle in radians for normals and tangents, and texcoord units.
+  struct QuantizationError {
+    float position = 0.0f;
+    float direction = 0.0f;
+    float texcoord = 0.0f;
+  };
+  // Post-transform vertex cache efficiency before and after optimize(). The
+  // figures are kept in the mesh cache, so a warm load reports them too; all
+  // zeros means the mesh was not optimized.
+  struct OptimizationReport {
+    float acmrBefore = 0.0f, acmrAfter = 0.0f;
+    float atvrBefore = 0.0f, atvrAfter = 0.0f;
+  };
+  // Vertex format of one buffer object; meshes with equal formats can share
+  // buffers and a vertex array (see MeshArena).
+  struct VertexAttribute {
+    GLuint index;
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    GLuint offset;
+  };
+  struct VertexStream {
+    GLsizei stride = 0;
+    std::vector<VertexAttribute> attributes;
+    std::vector<unsigned char> data;
+  };
+  // One indexed draw per submesh, as needed by indirect and batched drawing.
+  // firstIndex is in units of indexType.
+  struct DrawCommand {
+    GLuint count;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLenum indexType;
+  };
+  // GPU memory used by the mesh, and what 32-bit indices would have taken.
+  struct MemoryReport {
+    size_t vertexBytes = 0;
+    size_t indexBytes = 0;
+    size_t unpackedIndexBytes = 0;
+  };
 
   Mesh();
   ~Mesh();
@@ -55,25 +128,100 @@ public:
   void generateTexcoords();
   void calculateTangentSpace();
   void flipUVs();
+  void allowByteIndices();
+  void optimize();
+  // load() also builds a triangle BVH for raycast() and keeps the triangles
+  // for getTriangles(), e.g. to use the mesh as an occluder.
+  void enableRaycast();
+  void setCacheDirectory(const std::string &directory);
+  void setVertexLayout(VertexLayout layout);
+  VertexLayout getVertexLayout();
+  void setPositionFormat(PositionFormat format);
+  void setDirectionFormat(DirectionFormat format);
+  void setTexcoordFormat(TexcoordFormat format);
+  // Uploads into the arena's shared buffers instead of the mesh's own.
+  void setArena(MeshArena *arena);
 
+  // create() is load() followed by upload(). load() only touches CPU data
+  // and may run on any thread; upload() needs the OpenGL context. load()
+  // exits on a file that cannot be imported; with an importer it returns
+  // false instead, leaves the mesh empty and keeps the reason in
+  // getLoadError().
   void create(const std::string &filename);
+  void load(const std::string &filename);
+  bool load(const std::string &filename, Assimp::Importer &importer);
+  const std::string &getLoadError() const;
+  void upload();
   void draw() override;
+  // Draws every submesh instances times; the per-instance attributes must
+  // already be set on the mesh's vertex array (see InstanceBuffer).
+  void drawInstanced(GLsizei instances);
+  // Binds the mesh's vertex array (shared when in an arena) without drawing.
+  void bind();
+  GLuint getVertexArray() const;
+  void getDrawCommands(std::vector<DrawCommand> &commands) const;
 
   bool hasNormals();
   bool hasTexcoords();
   bool hasTangentsAndBitangents();
+  // IndirectRenderer passes the decode on to the shaders; code calling draw()
+  // directly sets the VERTEX_DECODE uniforms itself.
+  const VertexDecode &getVertexDecode() const;
+  const QuantizationError &getQuantizationError() const;
+  MemoryReport getMemoryReport() const;
+  const OptimizationReport &getOptimizationReport() const;
+
+  // Object-space bounds of the whole mesh and of each submesh, computed from
+  // the unquantized positions when loading.
+  const BoundingBox &getBoundingBox() const;
+  const BoundingSphere &getBoundingSphere() const;
+  size_t getSubmeshCount() const;
+  const BoundingBox &getSubmeshBoundingBox(size_t submesh) const;
+  const BoundingSphere &getSubmeshBoundingSphere(size_t submesh) const;
+  // Nearest triangle hit by an object-space ray; hit.primitive counts the
+  // triangles of all submeshes in order. Without enableRaycast() the
+  // bounding box is tested instead and hit.primitive is ~0u.
+  bool raycast(const Ray &ray, Bvh::Hit &hit) const;
+  // Three object-space corners per triangle, in the same order; empty
+  // without enableRaycast().
+  const std::vector<glm::vec3> &getTriangles() const;
 
 private:
+  friend class MeshArena;
+
   GLuint VaoId;
+  MeshArena *Arena;
+  MeshArenaAllocation *Allocation;
   unsigned int AssimpFlags;
+  bool ByteIndices;
+  bool Optimize;
+  bool Raycast;
+  OptimizationReport OptReport;
+  std::string Filename;
+  std::string LoadError;
+  std::string CacheDirectory;
+  VertexLayout Layout;
+  PositionFormat PositionFmt;
+  DirectionFormat DirectionFmt;
+  TexcoordFormat TexcoordFmt;
+  VertexDecode Decode;
+  QuantizationError QuantError;
   bool NormalsLoaded, TexcoordsLoaded, TangentsAndBitangentsLoaded;
 
   struct MeshData {
     unsigned int nIndices = 0;
     unsigned int baseIndex = 0;
     unsigned int baseVertex = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+    unsigned int indexOffset = 0;  // in bytes, into IndexData
+    BoundingBox box;
+    BoundingSphere sphere;
   };
   std::vector<MeshData> Meshes;
+  BoundingBox Box;
+  BoundingSphere Sphere;
+  Bvh TriangleBvh;
+  std::vector<glm::vec3> Triangles;  // three corners per triangle
 
   std::vector<glm::vec3> Positions;
   std::vector<glm::vec3> Normals;
@@ -84,9 +232,24 @@ private:
 #endif
   std::vector<unsigned int> Indices;
 
+  // Vertex data exactly as uploaded to the GPU, one entry per buffer object.
+  std::vector<VertexStream> Streams;
+  // Index data as uploaded, each submesh using the smallest index type that
+  // holds its baseVertex-relative indices.
+  std::vector<unsigned char> IndexData;
+
   void clear();
+  bool import(const std::string &filename, Assimp::Importer &importer);
   void processScene(const aiScene *scene);
-  void processMesh(const aiMesh *mesh);
+  void processMesh(const aiMesh *mesh, MeshData &data);
+  void optimizeMeshes();
+  void computeBounds();
+  void buildTriangleBvh();
+  std::string getCacheFilename(const std::string &filename);
+  bool readCache(const std::string &filename);
+  void writeCache(const std::string &filename);
+  void buildVertexStreams();
+  void buildIndexBuffer();
   void createBufferObjects();
   void destroyBufferObjects();
 };
@@ -0,0 +1,316 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Shared Mesh Arena Class
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglMeshArena.hpp"
+
+#include <algorithm>
+
+#include "./mglState.hpp"
+
+namespace mgl {
+
+////////////////////////////////////////////////////////////////////// MeshArena
+
+static const unsigned int INDEX_ALIGNMENT = 4;
+
+static unsigned int alignUp(unsigned int value, unsigned int alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+MeshArena::MeshArena(unsigned int vertex_capacity, unsigned int index_capacity)
+    : VertexCapacity(vertex_capacity), IndexCapacity(index_capacity) {}
+
+MeshArena::~MeshArena() {
+  State &state = State::getInstance();
+  for (Pool &pool : Pools) {
+    for (MeshArenaAllocation *allocation : pool.allocations) {
+      delete allocation;
+    }
+    state.deleteVertexArrays(1, &pool.VaoId);
+    state.deleteBuffers(static_cast<GLsizei>(pool.VboIds.size()),
+                        pool.VboIds.data());
+    state.deleteBuffers(1, &pool.IboId);
+  }
+}
+
+bool MeshArena::reserve(std::vector<Range> &free_ranges, unsigned int &top,
+                        unsigned int capacity, unsigned int size,
+                        unsigned int alignment, unsigned int &begin) {
+  for (size_t i = 0; i < free_ranges.size(); i++) {
+    const Range range = free_ranges[i];
+    const unsigned int aligned = alignUp(range.begin, alignment);
+    if (aligned + size > range.end) {
+      continue;
+    }
+    begin = aligned;
+    free_ranges.erase(free_ranges.begin() + i);
+    if (aligned + size < range.end) {
+      free_ranges.insert(free_ranges.begin() + i, {aligned + size, range.end});
+    }
+    if (range.begin < aligned) {
+      free_ranges.insert(free_ranges.begin() + i, {range.begin, aligned});
+    }
+    return true;
+  }
+  const unsigned int aligned = alignUp(top, alignment);
+  if (aligned + size > capacity) {
+    return false;
+  }
+  begin = aligned;
+  top = aligned + size;
+  return true;
+}
+
+void MeshArena::release(std::vector<Range> &free_ranges, unsigned int &top,
+                        Range range) {
+  if (range.begin == range.end) {
+    return;
+  }
+  // Keep ranges sorted and merged with their neighbours.
+  auto it = std::lower_bound(
+      free_ranges.begin(), free_ranges.end(), range,
+      [](const Range &a, const Range &b) { return a.begin < b.begin; });
+  it = free_ranges.insert(it, range);
+  if (it + 1 != free_ranges.end() && it->end == (it + 1)->begin) {
+    it->end = (it + 1)->end;
+    free_ranges.erase(it + 1);
+  }
+  if (it != free_ranges.begin() && (it - 1)->end == it->begin) {
+    (it - 1)->end = it->end;
+    it = free_ranges.erase(it) - 1;
+  }
+  if (it->end == top) {
+    top = it->begin;
+    free_ranges.erase(it);
+  }
+}
+
+static bool sameFormat(const std::vector<Mesh::VertexStream> &a,
+                       const std::vector<Mesh::VertexStream> &b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t s = 0; s < a.size(); s++) {
+    if (a[s].stride != b[s].stride ||
+        a[s].attributes.size() != b[s].attributes.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < a[s].attributes.size(); i++) {
+      const Mesh::VertexAttribute &x = a[s].attributes[i];
+      const Mesh::VertexAttribute &y = b[s].attributes[i];
+      if (x.index != y.index || x.size != y.size || x.type != y.type ||
+          x.normalized != y.normalized || x.offset != y.offset) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+size_t MeshArena::findPool(const std::vector<Mesh::VertexStream> &streams) {
+  for (size_t i = 0; i < Pools.size(); i++) {
+    if (sameFormat(Pools[i].format, streams)) {
+      return i;
+    }
+  }
+  Pools.push_back(Pool());
+  Pool &pool = Pools.back();
+  for (const Mesh::VertexStream &stream : streams) {
+    Mesh::VertexStream format;
+    format.stride = stream.stride;
+    format.attributes = stream.attributes;
+    pool.format.push_back(format);
+  }
+  resize(pool, VertexCapacity, IndexCapacity);
+  return Pools.size() - 1;
+}
+
+void MeshArena::setupVertexArray(Pool &pool) {
+  State &state = State::getInstance();
+  if (pool.VaoId == 0) {
+    glGenVertexArrays(1, &pool.VaoId);
+  }
+  state.bindVertexArray(pool.VaoId);
+  for (size_t s = 0; s < pool.format.size(); s++) {
+    const Mesh::VertexStream &stream = pool.format[s];
+    state.bindBuffer(GL_ARRAY_BUFFER, pool.VboIds[s]);
+    for (const Mesh::VertexAttribute &attribute : stream.attributes) {
+      glEnableVertexAttribArray(attribute.index);
+      glVertexAttribPointer(
+          attribute.index, attribute.size, attribute.type,
+          attribute.normalized, stream.stride,
+          reinterpret_cast<void *>(static_cast<size_t>(attribute.offset)));
+    }
+  }
+  state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.IboId);
+}
+
+void MeshArena::resize(Pool &pool, unsigned int vertex_capacity,
+                       unsigned int index_capacity) {
+  State &state = State::getInstance();
+  std::vector<GLuint> vbos(pool.format.size());
+  GLuint ibo;
+  glGenBuffers(static_cast<GLsizei>(vbos.size()), vbos.data());
+  glGenBuffers(1, &ibo);
+  for (size_t s = 0; s < vbos.size(); s++) {
+    state.bindBuffer(GL_COPY_WRITE_BUFFER, vbos[s]);
+    glBufferData(GL_COPY_WRITE_BUFFER,
+                 static_cast<GLsizeiptr>(vertex_capacity) *
+                     pool.format[s].stride,
+                 nullptr, GL_STATIC_DRAW);
+  }
+  state.bindBuffer(GL_COPY_WRITE_BUFFER, ibo);
+  glBufferData(GL_COPY_WRITE_BUFFER, index_capacity, nullptr, GL_STATIC_DRAW);
+
+  // Copy live allocations to the new buffers, packed in their current order.
+  std::vector<MeshArenaAllocation *> order = pool.allocations;
+  std::sort(order.begin(), order.end(),
+            [](const MeshArenaAllocation *a, const MeshArenaAllocation *b) {
+              return a->baseVertex < b->baseVertex;
+            });
+  unsigned int next = 0;
+  for (MeshArenaAllocation *allocation : order) {
+    for (size_t s = 0; s < vbos.size() && allocation->nVertices > 0; s++) {
+      const GLsizeiptr stride = pool.format[s].stride;
+      state.bindBuffer(GL_COPY_READ_BUFFER, pool.VboIds[s]);
+      state.bindBuffer(GL_COPY_WRITE_BUFFER, vbos[s]);
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                          allocation->baseVertex * stride, next * stride,
+                          allocation->nVertices * stride);
+    }
+    allocation->baseVertex = next;
+    next += allocation->nVertices;
+  }
+  pool.vertexTop = next;
+
+  std::sort(order.begin(), order.end(),
+            [](const MeshArenaAllocation *a, const MeshArenaAllocation *b) {
+              return a->indexOffset < b->indexOffset;
+            });
+  next = 0;
+  state.bindBuffer(GL_COPY_READ_BUFFER, pool.IboId);
+  state.bindBuffer(GL_COPY_WRITE_BUFFER, ibo);
+  for (MeshArenaAllocation *allocation : order) {
+    if (allocation->indexBytes > 0) {
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                          allocation->indexOffset, next,
+                          allocation->indexBytes);
+    }
+    allocation->indexOffset = next;
+    next += alignUp(allocation->indexBytes, INDEX_ALIGNMENT);
+  }
+  pool.indexTop = next;
+
+  state.deleteBuffers(static_cast<GLsizei>(pool.VboIds.size()),
+                      pool.VboIds.data());
+  if (pool.IboId != 0) {
+    state.deleteBuffers(1, &pool.IboId);
+  }
+  pool.VboIds = vbos;
+  pool.IboId = ibo;
+  pool.vertexCapacity = vertex_capacity;
+  pool.indexCapacity = index_capacity;
+  pool.freeVertices.clear();
+  pool.freeIndices.clear();
+  setupVertexArray(pool);
+}
+
+MeshArenaAllocation *
+MeshArena::allocate(const std::vector<Mesh::VertexStream> &streams,
+                    const std::vector<unsigned char> &indices) {
+  const size_t p = findPool(streams);
+  Pool &pool = Pools[p];
+  const unsigned int n_vertices =
+      streams.empty() ? 0
+                      : static_cast<unsigned int>(streams[0].data.size() /
+                                                  streams[0].stride);
+  const unsigned int n_bytes = static_cast<unsigned int>(indices.size());
+
+  MeshArenaAllocation *allocation = new MeshArenaAllocation();
+  allocation->pool = p;
+  allocation->nVertices = n_vertices;
+  while (!reserve(pool.freeVertices, pool.vertexTop, pool.vertexCapacity,
+                  n_vertices, 1, allocation->baseVertex)) {
+    resize(pool, std::max(pool.vertexCapacity * 2, pool.vertexTop + n_vertices),
+           pool.indexCapacity);
+  }
+  pool.allocations.push_back(allocation);
+  while (!reserve(pool.freeIndices, pool.indexTop, pool.indexCapacity,
+                  alignUp(n_bytes, INDEX_ALIGNMENT), INDEX_ALIGNMENT,
+                  allocation->indexOffset)) {
+    resize(pool, pool.vertexCapacity,
+           std::max(pool.indexCapacity * 2,
+                    alignUp(pool.indexTop + n_bytes, INDEX_ALIGNMENT)));
+  }
+  allocation->indexBytes = n_bytes;
+
+  State &state = State::getInstance();
+  for (size_t s = 0; s < streams.size(); s++) {
+    state.bindBuffer(GL_COPY_WRITE_BUFFER, pool.VboIds[s]);
+    glBufferSubData(GL_COPY_WRITE_BUFFER,
+                    static_cast<GLintptr>(allocation->baseVertex) *
+                        streams[s].stride,
+                    streams[s].data.size(), streams[s].data.data());
+  }
+  state.bindBuffer(GL_COPY_WRITE_BUFFER, pool.IboId);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, allocation->indexOffset, n_bytes,
+                  indices.data());
+  return allocation;
+}
+
+void MeshArena::free(MeshArenaAllocation *allocation) {
+  Pool &pool = Pools[allocation->pool];
+  release(pool.freeVertices, pool.vertexTop,
+          {allocation->baseVertex,
+           allocation->baseVertex + allocation->nVertices});
+  release(pool.freeIndices, pool.indexTop,
+          {allocation->indexOffset,
+           allocation->indexOffset +
+               alignUp(allocation->indexBytes, INDEX_ALIGNMENT)});
+  pool.allocations.erase(std::find(pool.allocations.begin(),
+                                   pool.allocations.end(), allocation));
+  delete allocation;
+}
+
+void MeshArena::compact() {
+  for (Pool &pool : Pools) {
+    if (!pool.freeVertices.empty() || !pool.freeIndices.empty()) {
+      resize(pool, pool.vertexCapacity, pool.indexCapacity);
+    }
+  }
+}
+
+void MeshArena::bind(const MeshArenaAllocation *allocation) {
+  State::getInstance().bindVertexArray(Pools[allocation->pool].VaoId);
+}
+
+GLuint MeshArena::getVertexArray(const MeshArenaAllocation *allocation) const {
+  return Pools[allocation->pool].VaoId;
+}
+
+MeshArena::Stats MeshArena::getStats() const {
+  Stats stats;
+  stats.pools = Pools.size();
+  for (const Pool &pool : Pools) {
+    GLsizei stride = 0;
+    for (const Mesh::VertexStream &stream : pool.format) {
+      stride += stream.stride;
+    }
+    stats.allocations += pool.allocations.size();
+    for (const MeshArenaAllocation *allocation : pool.allocations) {
+      stats.vertexBytes += static_cast<size_t>(allocation->nVertices) * stride;
+      stats.indexBytes += allocation->indexBytes;
+    }
+    stats.vertexCapacity += static_cast<size_t>(pool.vertexCapacity) * stride;
+    stats.indexCapacity += pool.indexCapacity;
+  }
+  return stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
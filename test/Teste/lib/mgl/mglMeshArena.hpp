@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Shared Mesh Arena Class
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_MESH_ARENA_HPP
+#define MGL_MESH_ARENA_HPP
+
+#include <GL/glew.h>
+
+#include <vector>
+
+#include "./mglMesh.hpp"
+
+namespace mgl {
+
+class MeshArena;
+struct MeshArenaAllocation;
+
+//////////////////////////////////////////////////////////// MeshArenaAllocation
+
+// Where a mesh lives inside the arena, like MeshData at arena scope. The
+// arena owns it and updates it in place when the data moves.
+
+struct MeshArenaAllocation {
+  size_t pool = 0;
+  unsigned int baseVertex = 0;
+  unsigned int nVertices = 0;
+  unsigned int indexOffset = 0;  // in bytes
+  unsigned int indexBytes = 0;
+};
+
+////////////////////////////////////////////////////////////////////// MeshArena
+
+// Suballocates the vertex and index data of many meshes into a few large
+// buffers, with one pool (vertex array, vertex buffers and index buffer) per
+// vertex format. Pools grow by doubling; freed ranges are reused first-fit
+// and compact() squeezes them out. The arena must outlive its meshes.
+
+class MeshArena {
+public:
+  struct Stats {
+    size_t pools = 0;
+    size_t allocations = 0;
+    size_t vertexBytes = 0, vertexCapacity = 0;
+    size_t indexBytes = 0, indexCapacity = 0;
+  };
+
+  explicit MeshArena(unsigned int vertex_capacity = 1 << 16,
+                     unsigned int index_capacity = 1 << 20);
+  ~MeshArena();
+  MeshArena(const MeshArena &) = delete;
+  MeshArena &operator=(const MeshArena &) = delete;
+
+  MeshArenaAllocation *allocate(const std::vector<Mesh::VertexStream> &streams,
+                                const std::vector<unsigned char> &indices);
+  void free(MeshArenaAllocation *allocation);
+  void compact();
+  void bind(const MeshArenaAllocation *allocation);
+  GLuint getVertexArray(const MeshArenaAllocation *allocation) const;
+  Stats getStats() const;
+
+private:
+  struct Range {
+    unsigned int begin, end;
+  };
+  struct Pool {
+    std::vector<Mesh::VertexStream> format;  // without data
+    GLuint VaoId = 0;
+    std::vector<GLuint> VboIds;
+    GLuint IboId = 0;
+    unsigned int vertexCapacity = 0, vertexTop = 0;
+    unsigned int indexCapacity = 0, indexTop = 0;
+    std::vector<Range> freeVertices, freeIndices;
+    std::vector<MeshArenaAllocation *> allocations;
+  };
+  std::vector<Pool> Pools;
+  unsigned int VertexCapacity, IndexCapacity;
+
+  static bool reserve(std::vector<Range> &free_ranges, unsigned int &top,
+                      unsigned int capacity, unsigned int size,
+                      unsigned int alignment, unsigned int &begin);
+  static void release(std::vector<Range> &free_ranges, unsigned int &top,
+                      Range range);
+  size_t findPool(const std::vector<Mesh::VertexStream> &streams);
+  void resize(Pool &pool, unsigned int vertex_capacity,
+              unsigned int index_capacity);
+  void setupVertexArray(Pool &pool);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
+
+#endif /* MGL_MESH_ARENA_HPP */
@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Parallel Mesh Loader Class
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglMeshLoader.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <thread>
+
+namespace mgl {
+
+///////////////////////////////////////////////////////////////////// MeshLoader
+
+MeshLoader::MeshLoader(unsigned int n_threads)
+    : NumThreads(n_threads), LoadTime(0.0), UploadTime(0.0) {
+  if (NumThreads == 0) {
+    NumThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+}
+
+void MeshLoader::add(Mesh *mesh, const std::string &filename) {
+  Jobs.push_back({mesh, filename, std::string()});
+}
+
+const std::vector<std::string> &MeshLoader::getErrors() const {
+  return Errors;
+}
+
+double MeshLoader::getLoadTime() const { return LoadTime; }
+
+double MeshLoader::getUploadTime() const { return UploadTime; }
+
+bool MeshLoader::load() {
+  typedef std::chrono::steady_clock clock;
+  const clock::time_point start = clock::now();
+
+  std::atomic<size_t> next(0);
+  auto worker = [this, &next]() {
+    Assimp::Importer importer;
+    for (size_t i = next++; i < Jobs.size(); i = next++) {
+      Job &job = Jobs[i];
+      // Failures are kept with the job and reported after the join.
+      try {
+        if (!job.mesh->load(job.filename, importer)) {
+          job.error = job.mesh->getLoadError();
+        }
+      } catch (const std::exception &e) {
+        job.error = e.what();
+      }
+      if (!job.error.empty()) {
+        importer.FreeScene();
+      }
+    }
+  };
+  const unsigned int n_workers =
+      std::min(NumThreads, static_cast<unsigned int>(Jobs.size()));
+  std::vector<std::thread> threads;
+  for (unsigned int i = 1; i < n_workers; i++) {
+    threads.emplace_back(worker);
+  }
+  worker();  // the calling thread takes its share
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  const clock::time_point loaded = clock::now();
+
+  Errors.clear();
+  for (Job &job : Jobs) {
+    if (job.error.empty()) {
+      job.mesh->upload();
+    } else {
+      Errors.push_back(job.filename + ": " + job.error);
+    }
+  }
+  const clock::time_point uploaded = clock::now();
+
+  LoadTime = std::chrono::duration<double>(loaded - start).count();
+  UploadTime = std::chrono::duration<double>(uploaded - loaded).count();
+#ifdef DEBUG
+  std::cout << "Loaded " << Jobs.size() << " mesh file(s) on " << n_workers
+            << " thread(s) in " << LoadTime << "s, uploaded in " << UploadTime
+            << "s" << std::endl;
+#endif
+  Jobs.clear();
+  return Errors.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
@@ -0,0 +1,58 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Parallel Mesh Loader Class
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_MESH_LOADER_HPP
+#define MGL_MESH_LOADER_HPP
+
+#include <string>
+#include <vector>
+
+#include "./mglMesh.hpp"
+
+namespace mgl {
+
+class MeshLoader;
+
+///////////////////////////////////////////////////////////////////// MeshLoader
+
+// Loads a batch of meshes on a pool of worker threads, each with its own
+// Assimp importer, then uploads them on the calling thread, which must own
+// the OpenGL context. Import options (Assimp flags, layout, cache, ...) are
+// taken from each Mesh, so they must be set before load() is called.
+//
+// A file that fails to load does not stop the others. Its mesh is not
+// uploaded, load() returns false and getErrors() tells which files failed
+// and why.
+
+class MeshLoader {
+public:
+  explicit MeshLoader(unsigned int n_threads = 0);  // 0: one per core
+
+  void add(Mesh *mesh, const std::string &filename);
+  bool load();
+  // "filename: reason" for each file that failed in the last load().
+  const std::vector<std::string> &getErrors() const;
+  double getLoadTime() const;    // seconds spent importing
+  double getUploadTime() const;  // seconds spent uploading
+
+private:
+  struct Job {
+    Mesh *mesh;
+    std::string filename;
+    std::string error;  // empty when loaded
+  };
+  std::vector<Job> Jobs;
+  std::vector<std::string> Errors;
+  unsigned int NumThreads;
+  double LoadTime, UploadTime;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
+
+#endif /* MGL_MESH_LOADER_HPP */
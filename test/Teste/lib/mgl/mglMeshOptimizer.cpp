@@ -0,0 +1,275 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Mesh Optimization (vertex cache, overdraw and vertex fetch)
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglMeshOptimizer.hpp"
+
+#include <algorithm>
+
+namespace mgl {
+
+////////////////////////////////////////////////////////////////// VERTEX CACHE
+
+// A FIFO cache is emulated with timestamps: a vertex is in the cache while
+// fewer than cache_size misses happened since it was last loaded.
+
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int> &indices,
+                                    size_t n_vertices,
+                                    unsigned int cache_size) {
+  VertexCacheStats stats;
+  if (indices.empty()) {
+    return stats;
+  }
+  std::vector<unsigned int> cache_time(n_vertices, 0);
+  std::vector<char> referenced(n_vertices, 0);
+  unsigned int time = cache_size + 1;
+  size_t misses = 0, unique = 0;
+  for (const unsigned int v : indices) {
+    if (time - cache_time[v] > cache_size) {
+      cache_time[v] = time++;
+      misses++;
+    }
+    if (!referenced[v]) {
+      referenced[v] = 1;
+      unique++;
+    }
+  }
+  stats.acmr = static_cast<float>(misses) / (indices.size() / 3);
+  stats.atvr = static_cast<float>(misses) / unique;
+  return stats;
+}
+
+void optimizeVertexCache(std::vector<unsigned int> &indices, size_t n_vertices,
+                         unsigned int cache_size) {
+  const size_t n_triangles = indices.size() / 3;
+  if (n_triangles == 0) {
+    return;
+  }
+
+  // Vertex-triangle adjacency and number of triangles left per vertex.
+  std::vector<unsigned int> live(n_vertices, 0);
+  for (const unsigned int v : indices) {
+    live[v]++;
+  }
+  std::vector<unsigned int> offsets(n_vertices + 1, 0);
+  for (size_t v = 0; v < n_vertices; v++) {
+    offsets[v + 1] = offsets[v] + live[v];
+  }
+  std::vector<unsigned int> adjacency(indices.size());
+  std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+  for (size_t i = 0; i < indices.size(); i++) {
+    adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+  }
+
+  std::vector<unsigned int> cache_time(n_vertices, 0);
+  std::vector<char> emitted(n_triangles, 0);
+  std::vector<unsigned int> dead_end, candidates, output;
+  dead_end.reserve(indices.size());
+  output.reserve(indices.size());
+  unsigned int time = cache_size + 1;
+  size_t cursor = 0;
+  long fan = indices[0];
+
+  while (fan >= 0) {
+    // Emit every remaining triangle around the fanning vertex.
+    candidates.clear();
+    for (unsigned int j = offsets[fan]; j < offsets[fan + 1]; j++) {
+      const unsigned int t = adjacency[j];
+      if (emitted[t]) {
+        continue;
+      }
+      for (unsigned int c = 0; c < 3; c++) {
+        const unsigned int v = indices[3 * t + c];
+        output.push_back(v);
+        dead_end.push_back(v);
+        candidates.push_back(v);
+        live[v]--;
+        if (time - cache_time[v] > cache_size) {
+          cache_time[v] = time++;
+        }
+      }
+      emitted[t] = 1;
+    }
+
+    // Prefer the oldest vertex that will still be in the cache after its
+    // remaining triangles are emitted.
+    fan = -1;
+    long best_priority = -1;
+    for (const unsigned int v : candidates) {
+      if (live[v] == 0) {
+        continue;
+      }
+      long priority = 0;
+      if (time - cache_time[v] + 2 * live[v] <= cache_size) {
+        priority = time - cache_time[v];
+      }
+      if (priority > best_priority) {
+        best_priority = priority;
+        fan = v;
+      }
+    }
+    while (fan < 0 && !dead_end.empty()) {
+      const unsigned int v = dead_end.back();
+      dead_end.pop_back();
+      if (live[v] > 0) {
+        fan = v;
+      }
+    }
+    while (fan < 0 && cursor < n_vertices) {
+      if (live[cursor] > 0) {
+        fan = static_cast<long>(cursor);
+      }
+      cursor++;
+    }
+  }
+  indices.swap(output);
+}
+
+////////////////////////////////////////////////////////////////////// OVERDRAW
+
+struct Cluster {
+  size_t begin, end;
+  float sort_key;
+};
+
+static glm::vec3 triangleNormal(const std::vector<unsigned int> &indices,
+                                const glm::vec3 *positions, size_t t) {
+  const glm::vec3 &p0 = positions[indices[3 * t]];
+  const glm::vec3 &p1 = positions[indices[3 * t + 1]];
+  const glm::vec3 &p2 = positions[indices[3 * t + 2]];
+  return glm::cross(p1 - p0, p2 - p0);  // length is twice the area
+}
+
+static glm::vec3 triangleCentroid(const std::vector<unsigned int> &indices,
+                                  const glm::vec3 *positions, size_t t) {
+  return (positions[indices[3 * t]] + positions[indices[3 * t + 1]] +
+          positions[indices[3 * t + 2]]) /
+         3.0f;
+}
+
+void optimizeOverdraw(std::vector<unsigned int> &indices,
+                      const glm::vec3 *positions, size_t n_vertices,
+                      float threshold, unsigned int cache_size) {
+  const size_t n_triangles = indices.size() / 3;
+  if (n_triangles == 0) {
+    return;
+  }
+
+  // Hard boundaries are where the cache-optimized order restarts, i.e. a
+  // triangle misses on all three vertices.
+  std::vector<unsigned int> cache_time(n_vertices, 0);
+  unsigned int time = cache_size + 1;
+  std::vector<unsigned char> misses(n_triangles, 0);
+  std::vector<size_t> hard;
+  for (size_t t = 0; t < n_triangles; t++) {
+    for (unsigned int c = 0; c < 3; c++) {
+      const unsigned int v = indices[3 * t + c];
+      if (time - cache_time[v] > cache_size) {
+        cache_time[v] = time++;
+        misses[t]++;
+      }
+    }
+    if (t == 0 || misses[t] == 3) {
+      hard.push_back(t);
+    }
+  }
+  hard.push_back(n_triangles);
+
+  // Split hard clusters further while each piece, drawn from a cold cache,
+  // stays within threshold of the ACMR of the whole hard cluster.
+  std::vector<Cluster> clusters;
+  for (size_t h = 0; h + 1 < hard.size(); h++) {
+    size_t cluster_misses = 0;
+    for (size_t t = hard[h]; t < hard[h + 1]; t++) {
+      cluster_misses += misses[t];
+    }
+    const float limit = threshold * cluster_misses / (hard[h + 1] - hard[h]);
+
+    time += cache_size + 1;
+    size_t begin = hard[h], piece_misses = 0;
+    for (size_t t = hard[h]; t < hard[h + 1]; t++) {
+      for (unsigned int c = 0; c < 3; c++) {
+        const unsigned int v = indices[3 * t + c];
+        if (time - cache_time[v] > cache_size) {
+          cache_time[v] = time++;
+          piece_misses++;
+        }
+      }
+      const size_t n = t + 1 - begin;
+      if (t + 1 < hard[h + 1] &&
+          static_cast<float>(piece_misses) / n <= limit) {
+        clusters.push_back({begin, t + 1, 0.0f});
+        begin = t + 1;
+        piece_misses = 0;
+        time += cache_size + 1;
+      }
+    }
+    clusters.push_back({begin, hard[h + 1], 0.0f});
+  }
+
+  // Clusters facing away from the mesh center are likely occluders.
+  glm::vec3 mesh_center(0.0f);
+  float mesh_area = 0.0f;
+  for (size_t t = 0; t < n_triangles; t++) {
+    const float area = glm::length(triangleNormal(indices, positions, t));
+    mesh_center += triangleCentroid(indices, positions, t) * area;
+    mesh_area += area;
+  }
+  if (mesh_area > 0.0f) {
+    mesh_center /= mesh_area;
+  }
+  for (Cluster &cluster : clusters) {
+    glm::vec3 center(0.0f), normal(0.0f);
+    float area = 0.0f;
+    for (size_t t = cluster.begin; t < cluster.end; t++) {
+      const glm::vec3 n = triangleNormal(indices, positions, t);
+      const float a = glm::length(n);
+      center += triangleCentroid(indices, positions, t) * a;
+      normal += n;
+      area += a;
+    }
+    const float length = glm::length(normal);
+    if (area > 0.0f && length > 0.0f) {
+      cluster.sort_key = glm::dot(center / area - mesh_center, normal / length);
+    }
+  }
+  std::stable_sort(clusters.begin(), clusters.end(),
+                   [](const Cluster &a, const Cluster &b) {
+                     return a.sort_key > b.sort_key;
+                   });
+
+  std::vector<unsigned int> output;
+  output.reserve(indices.size());
+  for (const Cluster &cluster : clusters) {
+    output.insert(output.end(), indices.begin() + 3 * cluster.begin,
+                  indices.begin() + 3 * cluster.end);
+  }
+  indices.swap(output);
+}
+
+////////////////////////////////////////////////////////////////// VERTEX FETCH
+
+void optimizeVertexFetch(std::vector<unsigned int> &indices, size_t n_vertices,
+                         std::vector<unsigned int> &remap) {
+  const unsigned int unused = ~0u;
+  remap.assign(n_vertices, unused);
+  unsigned int next = 0;
+  for (unsigned int &v : indices) {
+    if (remap[v] == unused) {
+      remap[v] = next++;
+    }
+    v = remap[v];
+  }
+  for (unsigned int &r : remap) {
+    if (r == unused) {
+      r = next++;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}  // namespace mgl
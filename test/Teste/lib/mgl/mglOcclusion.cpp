@@ -0,0 +1,388 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Software Occlusion Culling (CPU depth buffer and Hi-Z pyramid)
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglOcclusion.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include "./mglSimd.hpp"
+
+namespace mgl {
+
+//////////////////////////////////////////////////////////////////////// KERNELS
+
+// Pixel centers of one vector, relative to its first pixel.
+static const float PIXEL_CENTERS[MAX_LANES] = {0.5f, 1.5f, 2.5f, 3.5f,
+                                               4.5f, 5.5f, 6.5f, 7.5f};
+
+// Pixels outside the triangle get their depth pushed beyond the far plane
+// in proportion to how far outside they are, instead of being masked out,
+// so the depth test is a plain min with no per-lane branching.
+static const float OUTSIDE_PENALTY = 1e30f;
+
+// Rows y0..y1 of pixels x0..x1, with x0 a multiple of L::N and the span
+// rounded up to whole vectors, which stay inside the triangle's tile.
+template <typename L>
+static void rasterizeRows(const glm::vec3 *edges, const glm::vec3 &plane,
+                          float *depth, int width, int x0, int x1, int y0,
+                          int y1) {
+  typedef typename L::V V;
+  const V centers = L::load(PIXEL_CENTERS);
+  const V zero = L::set(0.0f), penalty = L::set(OUTSIDE_PENALTY);
+  const V a0 = L::set(edges[0].x), a1 = L::set(edges[1].x),
+          a2 = L::set(edges[2].x), dzdx = L::set(plane.x);
+  for (int y = y0; y <= y1; y++) {
+    const float py = y + 0.5f;
+    const V c0 = L::set(edges[0].y * py + edges[0].z);
+    const V c1 = L::set(edges[1].y * py + edges[1].z);
+    const V c2 = L::set(edges[2].y * py + edges[2].z);
+    const V cz = L::set(plane.y * py + plane.z);
+    float *row = depth + static_cast<size_t>(y) * width;
+    for (int x = x0; x <= x1; x += static_cast<int>(L::N)) {
+      const V px = L::add(L::set(static_cast<float>(x)), centers);
+      const V e0 = L::add(L::mul(a0, px), c0);
+      const V e1 = L::add(L::mul(a1, px), c1);
+      const V e2 = L::add(L::mul(a2, px), c2);
+      const V inside = L::min(e0, L::min(e1, e2));
+      const V outside = L::max(L::sub(zero, inside), zero);
+      const V z =
+          L::add(L::add(L::mul(dzdx, px), cz), L::mul(outside, penalty));
+      L::store(row + x, L::min(L::load(row + x), z));
+    }
+  }
+}
+
+/////////////////////////////////////////////////////////////// OcclusionCuller
+
+// Setting up fewer triangles per thread costs more than it saves.
+static const size_t MIN_TRIANGLES_PER_THREAD = 256;
+
+OcclusionCuller::OcclusionCuller(int width, int height,
+                                 unsigned int n_threads)
+    : NumThreads(n_threads), ViewProjection(1.0f), TaskWorkers(0),
+      Running(0), Generation(0), Stopping(false) {
+  if (NumThreads == 0) {
+    NumThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  TilesX = std::max(1, (width + TILE_WIDTH - 1) / TILE_WIDTH);
+  TilesY = std::max(1, (height + TILE_HEIGHT - 1) / TILE_HEIGHT);
+  Width = TilesX * TILE_WIDTH;
+  Height = TilesY * TILE_HEIGHT;
+  Workers.resize(NumThreads);
+  int w = Width, h = Height;
+  for (;;) {
+    Levels.push_back({w, h, std::vector<float>(w * h, 1.0f)});
+    if (w == 1 && h == 1) {
+      break;
+    }
+    w = (w + 1) / 2;
+    h = (h + 1) / 2;
+  }
+  for (unsigned int i = 1; i < NumThreads; i++) {
+    Threads.emplace_back(&OcclusionCuller::runWorker, this, i);
+  }
+}
+
+OcclusionCuller::~OcclusionCuller() {
+  {
+    std::lock_guard<std::mutex> lock(PoolMutex);
+    Stopping = true;
+  }
+  TaskReady.notify_all();
+  for (std::thread &thread : Threads) {
+    thread.join();
+  }
+}
+
+// Worker i waits for each task and runs it if the task has more than i
+// workers; the last one to finish wakes parallel().
+void OcclusionCuller::runWorker(unsigned int i) {
+  unsigned long long seen = 0;
+  std::unique_lock<std::mutex> lock(PoolMutex);
+  for (;;) {
+    TaskReady.wait(lock, [this, seen]() {
+      return Stopping || Generation != seen;
+    });
+    if (Stopping) {
+      return;
+    }
+    seen = Generation;
+    if (i >= TaskWorkers) {
+      continue;
+    }
+    lock.unlock();
+    Task(i);  // left untouched until every worker is done
+    lock.lock();
+    if (--Running == 0) {
+      TaskDone.notify_one();
+    }
+  }
+}
+
+void OcclusionCuller::parallel(
+    unsigned int n_workers, const std::function<void(unsigned int)> &work) {
+  if (n_workers <= 1) {
+    work(0);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(PoolMutex);
+    Task = work;
+    TaskWorkers = n_workers;
+    Running = n_workers - 1;
+    Generation++;
+  }
+  TaskReady.notify_all();
+  work(0);
+  std::unique_lock<std::mutex> lock(PoolMutex);
+  TaskDone.wait(lock, [this]() { return Running == 0; });
+}
+
+void OcclusionCuller::begin(const glm::mat4 &view_projection) {
+  ViewProjection = view_projection;
+  Occluders.clear();
+  Counters = Stats();
+}
+
+void OcclusionCuller::addOccluder(const glm::vec3 *corners,
+                                  size_t n_triangles,
+                                  const glm::mat4 &model_matrix) {
+  Occluders.push_back({corners, n_triangles, ViewProjection * model_matrix});
+  Counters.occluderTriangles += n_triangles;
+}
+
+// Sets up triangles begin..end of all occluders, in order.
+void OcclusionCuller::setup(Bins &bins, size_t begin, size_t end) {
+  const glm::vec2 scale(Width * 0.5f, Height * 0.5f);
+  size_t base = 0;
+  for (const Occluder &occluder : Occluders) {
+    const size_t first = std::max(begin, base);
+    const size_t last = std::min(end, base + occluder.nTriangles);
+    for (size_t i = first; i < last; i++) {
+      const glm::vec3 *corners = occluder.corners + 3 * (i - base);
+      glm::vec3 p[3];
+      bool clipped = false;
+      for (int k = 0; k < 3; k++) {
+        const glm::vec4 clip = occluder.matrix * glm::vec4(corners[k], 1.0f);
+        if (clip.w <= 0.0f || clip.z < -clip.w) {
+          clipped = true;
+          break;
+        }
+        const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        p[k] = glm::vec3((ndc.x + 1.0f) * scale.x, (ndc.y + 1.0f) * scale.y,
+                         ndc.z * 0.5f + 0.5f);
+      }
+      const float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) -
+                         (p[2].x - p[0].x) * (p[1].y - p[0].y);
+      if (clipped || !(area > 0.0f)) {
+        continue;  // crosses the near plane, back facing or degenerate
+      }
+
+      // Pixel centers inside the triangle's bounds, clamped to the screen.
+      const float min_x = std::min(p[0].x, std::min(p[1].x, p[2].x));
+      const float max_x = std::max(p[0].x, std::max(p[1].x, p[2].x));
+      const float min_y = std::min(p[0].y, std::min(p[1].y, p[2].y));
+      const float max_y = std::max(p[0].y, std::max(p[1].y, p[2].y));
+      Triangle t;
+      t.x0 = static_cast<int>(std::ceil(std::max(min_x - 0.5f, 0.0f)));
+      t.y0 = static_cast<int>(std::ceil(std::max(min_y - 0.5f, 0.0f)));
+      t.x1 = static_cast<int>(std::floor(std::min(max_x - 0.5f, Width - 1.0f)));
+      t.y1 =
+          static_cast<int>(std::floor(std::min(max_y - 0.5f, Height - 1.0f)));
+      if (t.x0 > t.x1 || t.y0 > t.y1) {
+        continue;
+      }
+      for (int k = 0; k < 3; k++) {
+        const glm::vec3 &a = p[k], &b = p[(k + 1) % 3];
+        const float ex = a.y - b.y, ey = b.x - a.x;
+        t.edges[k] = glm::vec3(ex, ey, -(ex * a.x + ey * a.y));
+      }
+      const float dz1 = p[1].z - p[0].z, dz2 = p[2].z - p[0].z;
+      const float dzdx =
+          (dz1 * (p[2].y - p[0].y) - dz2 * (p[1].y - p[0].y)) / area;
+      const float dzdy =
+          (dz2 * (p[1].x - p[0].x) - dz1 * (p[2].x - p[0].x)) / area;
+      // Biased to the farthest depth within each pixel.
+      const float bias = 0.5f * (std::abs(dzdx) + std::abs(dzdy));
+      t.depth = glm::vec3(dzdx, dzdy,
+                          p[0].z - dzdx * p[0].x - dzdy * p[0].y + bias);
+
+      const uint32_t index = static_cast<uint32_t>(bins.triangles.size());
+      bins.triangles.push_back(t);
+      for (int ty = t.y0 / TILE_HEIGHT; ty <= t.y1 / TILE_HEIGHT; ty++) {
+        for (int tx = t.x0 / TILE_WIDTH; tx <= t.x1 / TILE_WIDTH; tx++) {
+          bins.tiles[ty * TilesX + tx].push_back(index);
+        }
+      }
+    }
+    base += occluder.nTriangles;
+  }
+}
+
+void OcclusionCuller::rasterizeTile(int tile) {
+  const int tile_x0 = (tile % TilesX) * TILE_WIDTH;
+  const int tile_y0 = (tile / TilesX) * TILE_HEIGHT;
+  float *depth = Levels[0].depth.data();
+  for (const Bins &bins : Workers) {
+    for (const uint32_t index : bins.tiles[tile]) {
+      const Triangle &t = bins.triangles[index];
+      const int x0 = std::max(t.x0, tile_x0);
+      const int x1 = std::min(t.x1, tile_x0 + TILE_WIDTH - 1);
+      const int y0 = std::max(t.y0, tile_y0);
+      const int y1 = std::min(t.y1, tile_y0 + TILE_HEIGHT - 1);
+      const int aligned = x0 - x0 % static_cast<int>(WideLanes::N);
+      rasterizeRows<WideLanes>(t.edges, t.depth, depth, Width, aligned, x1, y0,
+                               y1);
+    }
+  }
+}
+
+void OcclusionCuller::buildPyramid() {
+  for (size_t l = 1; l < Levels.size(); l++) {
+    const Level &below = Levels[l - 1];
+    Level &level = Levels[l];
+    for (int y = 0; y < level.height; y++) {
+      const int y0 = 2 * y, y1 = std::min(2 * y + 1, below.height - 1);
+      for (int x = 0; x < level.width; x++) {
+        const int x0 = 2 * x, x1 = std::min(2 * x + 1, below.width - 1);
+        level.depth[y * level.width + x] =
+            std::max(std::max(below.depth[y0 * below.width + x0],
+                              below.depth[y0 * below.width + x1]),
+                     std::max(below.depth[y1 * below.width + x0],
+                              below.depth[y1 * below.width + x1]));
+      }
+    }
+  }
+}
+
+void OcclusionCuller::rasterize() {
+  typedef std::chrono::steady_clock clock;
+  const clock::time_point start = clock::now();
+  const int n_tiles = TilesX * TilesY;
+  std::fill(Levels[0].depth.begin(), Levels[0].depth.end(), 1.0f);
+  for (Bins &bins : Workers) {
+    bins.triangles.clear();
+    bins.tiles.resize(n_tiles);
+    for (std::vector<uint32_t> &tile : bins.tiles) {
+      tile.clear();
+    }
+  }
+
+  const size_t total = Counters.occluderTriangles;
+  const unsigned int n_setup = static_cast<unsigned int>(std::min<size_t>(
+      NumThreads, std::max<size_t>(1, total / MIN_TRIANGLES_PER_THREAD)));
+  parallel(n_setup, [this, total, n_setup](unsigned int i) {
+    setup(Workers[i], total * i / n_setup, total * (i + 1) / n_setup);
+  });
+  Counters.rasterizedTriangles = 0;
+  for (const Bins &bins : Workers) {
+    Counters.rasterizedTriangles += bins.triangles.size();
+  }
+  const clock::time_point set_up = clock::now();
+
+  if (Counters.rasterizedTriangles > 0) {
+    std::atomic<int> next(0);
+    const unsigned int n_raster =
+        std::min(NumThreads, static_cast<unsigned int>(n_tiles));
+    parallel(n_raster, [this, &next, n_tiles](unsigned int) {
+      for (int tile = next++; tile < n_tiles; tile = next++) {
+        rasterizeTile(tile);
+      }
+    });
+  }
+  const clock::time_point rasterized = clock::now();
+
+  buildPyramid();
+  Counters.setupTime = std::chrono::duration<double>(set_up - start).count();
+  Counters.rasterTime =
+      std::chrono::duration<double>(rasterized - set_up).count();
+  Counters.pyramidTime =
+      std::chrono::duration<double>(clock::now() - rasterized).count();
+}
+
+bool OcclusionCuller::isVisible(const BoundingBox &box) {
+  Counters.tested++;
+  if (box.isEmpty()) {
+    return true;
+  }
+  glm::vec2 lower(FLT_MAX), upper(-FLT_MAX);
+  float nearest = FLT_MAX;
+  for (int k = 0; k < 8; k++) {
+    const glm::vec3 corner(k & 1 ? box.max.x : box.min.x,
+                           k & 2 ? box.max.y : box.min.y,
+                           k & 4 ? box.max.z : box.min.z);
+    const glm::vec4 clip = ViewProjection * glm::vec4(corner, 1.0f);
+    if (clip.w <= 0.0f || clip.z < -clip.w) {
+      return true;  // crosses the near plane
+    }
+    const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+    lower = glm::min(lower, glm::vec2(ndc));
+    upper = glm::max(upper, glm::vec2(ndc));
+    nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+  }
+  // Every pixel the screen rectangle touches and a one pixel border, since
+  // occluders only cover the pixels whose centers they contain.
+  const glm::vec2 size(Width, Height);
+  lower = glm::clamp((lower + 1.0f) * 0.5f * size - 1.0f, glm::vec2(0.0f),
+                     size - 1.0f);
+  upper = glm::clamp((upper + 1.0f) * 0.5f * size + 1.0f, glm::vec2(0.0f),
+                     size - 1.0f);
+  const int x0 = static_cast<int>(lower.x), y0 = static_cast<int>(lower.y);
+  const int x1 = static_cast<int>(upper.x), y1 = static_cast<int>(upper.y);
+
+  // The level where the rectangle spans at most 3 by 3 texels.
+  size_t l = 0;
+  while (l + 1 < Levels.size() && std::max(x1 - x0, y1 - y0) >> l > 1) {
+    l++;
+  }
+  const Level &level = Levels[l];
+  float farthest = 0.0f;
+  for (int y = y0 >> l; y <= y1 >> l; y++) {
+    for (int x = x0 >> l; x <= x1 >> l; x++) {
+      farthest = std::max(farthest, level.depth[y * level.width + x]);
+    }
+  }
+  if (nearest > farthest) {
+    Counters.occluded++;
+    return false;
+  }
+  return true;
+}
+
+int OcclusionCuller::getWidth() const { return Width; }
+
+int OcclusionCuller::getHeight() const { return Height; }
+
+size_t OcclusionCuller::getLevels() const { return Levels.size(); }
+
+const float *OcclusionCuller::getDepth(size_t level) const {
+  return Levels[level].depth.data();
+}
+
+int OcclusionCuller::getLevelWidth(size_t level) const {
+  return Levels[level].width;
+}
+
+int OcclusionCuller::getLevelHeight(size_t level) const {
+  return Levels[level].height;
+}
+
+const OcclusionCuller::Stats &OcclusionCuller::getStats() const {
+  return Counters;
+}
+
+const char *OcclusionCuller::getInstructionSet() {
+  return getSimdInstructionSet();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}  // namespace mgl
@@ -0,0 +1,140 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Software Occlusion Culling (CPU depth buffer and Hi-Z pyramid)
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_OCCLUSION_HPP
+#define MGL_OCCLUSION_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <glm/glm.hpp>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "./mglBounds.hpp"
+
+namespace mgl {
+
+class OcclusionCuller;
+
+/////////////////////////////////////////////////////////////// OcclusionCuller
+
+// Rasterizes occluder triangles at low resolution into a CPU depth buffer
+// and tests boxes against a hierarchical depth (Hi-Z) pyramid built from it.
+// Each frame: begin() with the camera's view-projection, addOccluder() for
+// every occluder, rasterize(), then isVisible() for each box.
+//
+// Occluder triangles are transformed and binned into screen tiles on worker
+// threads, and the tiles are then rasterized in parallel, several pixels at
+// a time (8 with AVX2, 4 with SSE2, see PoseBatch). The threads are started
+// with the culler and wait between passes, so a frame pays no thread
+// startup. Depth is z/w mapped to [0, 1] and each pyramid level keeps the
+// farthest depth of the four texels below. Everything errs on the side of
+// visibility: back faces, triangles crossing the near plane and boxes
+// crossing it are never occluding or occluded. Pixels are sampled at their
+// centers, so a box smaller than a pixel may still be culled through a gap
+// between two occluders.
+
+class OcclusionCuller {
+ public:
+  struct Stats {
+    size_t occluderTriangles = 0;    // given to addOccluder()
+    size_t rasterizedTriangles = 0;  // front facing and in front of the camera
+    size_t tested = 0;               // isVisible() calls since begin()
+    size_t occluded = 0;             // of which were hidden
+    double setupTime = 0.0;          // seconds transforming and binning
+    double rasterTime = 0.0;         // seconds rasterizing tiles
+    double pyramidTime = 0.0;        // seconds building the Hi-Z pyramid
+  };
+
+  static const int TILE_WIDTH = 32;
+  static const int TILE_HEIGHT = 16;
+
+  // The resolution is rounded up to whole tiles. 0 threads: one per core.
+  explicit OcclusionCuller(int width = 256, int height = 128,
+                           unsigned int n_threads = 0);
+  ~OcclusionCuller();
+  OcclusionCuller(const OcclusionCuller &) = delete;
+  OcclusionCuller &operator=(const OcclusionCuller &) = delete;
+
+  void begin(const glm::mat4 &view_projection);
+  // corners holds three object-space points per triangle, counter-clockwise
+  // when front facing; it must stay valid until rasterize().
+  void addOccluder(const glm::vec3 *corners, size_t n_triangles,
+                   const glm::mat4 &model_matrix);
+  void rasterize();
+  // Whether any part of the world-space box may be visible.
+  bool isVisible(const BoundingBox &box);
+
+  int getWidth() const;
+  int getHeight() const;
+  size_t getLevels() const;
+  // Level 0 is the depth buffer, row by row from the bottom; each level
+  // halves the resolution, rounding up.
+  const float *getDepth(size_t level) const;
+  int getLevelWidth(size_t level) const;
+  int getLevelHeight(size_t level) const;
+  const Stats &getStats() const;
+
+  // "AVX2", "SSE2" or "scalar", as selected at compile time.
+  static const char *getInstructionSet();
+
+ private:
+  struct Occluder {
+    const glm::vec3 *corners;
+    size_t nTriangles;
+    glm::mat4 matrix;  // model-view-projection
+  };
+  // Edge functions a * x + b * y + c, positive inside, and the depth plane,
+  // in pixels; x0..y1 are the covered pixel bounds, inclusive.
+  struct Triangle {
+    glm::vec3 edges[3];
+    glm::vec3 depth;
+    int x0, y0, x1, y1;
+  };
+  // Triangles set up by one worker, and their indices per tile.
+  struct Bins {
+    std::vector<Triangle> triangles;
+    std::vector<std::vector<uint32_t>> tiles;
+  };
+  struct Level {
+    int width, height;
+    std::vector<float> depth;
+  };
+
+  int Width, Height, TilesX, TilesY;
+  unsigned int NumThreads;
+  glm::mat4 ViewProjection;
+  std::vector<Occluder> Occluders;
+  std::vector<Bins> Workers;
+  std::vector<Level> Levels;
+  Stats Counters;
+
+  // Worker threads 1..NumThreads-1; the calling thread is worker 0.
+  std::vector<std::thread> Threads;
+  std::mutex PoolMutex;
+  std::condition_variable TaskReady, TaskDone;
+  std::function<void(unsigned int)> Task;
+  unsigned int TaskWorkers, Running;
+  unsigned long long Generation;
+  bool Stopping;
+
+  void runWorker(unsigned int i);
+  // Runs work(i) for i in 0..n_workers-1 and waits for all of them.
+  void parallel(unsigned int n_workers,
+                const std::function<void(unsigned int)> &work);
+  void setup(Bins &bins, size_t begin, size_t end);
+  void rasterizeTile(int tile);
+  void buildPyramid();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}  // namespace mgl
+
+#endif /* MGL_OCCLUSION_HPP */
@@ -0,0 +1,55 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Pose (Translation, Rotation, Scale)
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglPose.hpp"
+
+namespace mgl {
+
+/////////////////////////////////////////////////////////////////////////// Pose
+
+Pose::Pose()
+    : translation(0.0f), rotation(1.0f, 0.0f, 0.0f, 0.0f), scale(1.0f) {}
+
+Pose::Pose(const glm::vec3 &t, const glm::quat &r, const glm::vec3 &s)
+    : translation(t), rotation(r), scale(s) {}
+
+Pose Pose::fromMatrix(const glm::mat4 &matrix) {
+  glm::mat3 basis(matrix);
+  glm::vec3 s(glm::length(basis[0]), glm::length(basis[1]),
+              glm::length(basis[2]));
+  if (glm::determinant(basis) < 0.0f) {
+    s.x = -s.x;  // a mirror is kept as a negative x scale
+  }
+  for (int i = 0; i < 3; i++) {
+    if (s[i] != 0.0f) basis[i] /= s[i];
+  }
+  return Pose(glm::vec3(matrix[3]), glm::normalize(glm::quat_cast(basis)), s);
+}
+
+glm::mat4 Pose::toMatrix() const {
+  return composeMatrix(translation, rotation, scale);
+}
+
+Pose blend(const Pose &from, const Pose &to, float t) {
+  return Pose(glm::mix(from.translation, to.translation, t),
+              glm::slerp(from.rotation, to.rotation, t),
+              glm::mix(from.scale, to.scale, t));
+}
+
+glm::mat4 composeMatrix(const glm::vec3 &t, const glm::quat &r,
+                        const glm::vec3 &s) {
+  glm::mat4 m = glm::mat4_cast(r);
+  m[0] *= s.x;
+  m[1] *= s.y;
+  m[2] *= s.z;
+  m[3] = glm::vec4(t, 1.0f);
+  return m;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}  // namespace mgl
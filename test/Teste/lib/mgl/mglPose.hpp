@@ -0,0 +1,47 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Pose (Translation, Rotation, Scale)
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_POSE_HPP
+#define MGL_POSE_HPP
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace mgl {
+
+struct Pose;
+
+/////////////////////////////////////////////////////////////////////////// Pose
+
+// A transform kept as its components, so that poses are blended with
+// mix/slerp/mix and turned into a matrix with one TRS composition. Matrices
+// are decomposed once, when keyframes are set up, never per frame.
+
+struct Pose {
+  glm::vec3 translation;
+  glm::quat rotation;
+  glm::vec3 scale;
+
+  Pose();
+  Pose(const glm::vec3 &t, const glm::quat &r, const glm::vec3 &s);
+
+  // Assumes an affine matrix without shear, as built from translate, rotate
+  // and scale calls.
+  static Pose fromMatrix(const glm::mat4 &matrix);
+  glm::mat4 toMatrix() const;
+};
+
+Pose blend(const Pose &from, const Pose &to, float t);
+
+glm::mat4 composeMatrix(const glm::vec3 &t, const glm::quat &r,
+                        const glm::vec3 &s);
+
+////////////////////////////////////////////////////////////////////////////////
+}  // namespace mgl
+
+#endif /* MGL_POSE_HPP */
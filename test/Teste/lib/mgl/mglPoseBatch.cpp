@@ -0,0 +1,232 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Pose Batches (SIMD blending and composition)
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglPoseBatch.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "./mglSimd.hpp"
+
+namespace mgl {
+
+//////////////////////////////////////////////////////////////////////// KERNELS
+
+typedef const float *const Inputs[PoseBatch::COMPONENTS];
+typedef float *const Outputs[PoseBatch::COMPONENTS];
+
+// Same formula as glm::mix, so that the scalar path matches mgl::blend().
+template <typename L, typename V = typename L::V>
+static V mix(V a, V b, V one_minus_t, V t) {
+  return L::add(L::mul(a, one_minus_t), L::mul(b, t));
+}
+
+static void slerpWeights(const float *cosine, const float *t, float *w0,
+                         float *w1, size_t n) {
+  for (size_t k = 0; k < n; k++) {
+    if (cosine[k] > 1.0f - 1e-6f) {
+      w0[k] = 1.0f - t[k];  // nearly parallel: nlerp is exact enough
+      w1[k] = t[k];
+    } else {
+      const float angle = std::acos(cosine[k]);
+      const float sine = std::sin(angle);
+      w0[k] = std::sin((1.0f - t[k]) * angle) / sine;
+      w1[k] = std::sin(t[k] * angle) / sine;
+    }
+  }
+}
+
+// t holds one weight per pose, or a single weight for all when t_step is 0.
+template <typename L>
+static size_t blendRange(Inputs from, Inputs to, Outputs out, const float *t,
+                         size_t t_step, bool slerp, size_t begin, size_t end) {
+  typedef typename L::V V;
+  const V one = L::set(1.0f);
+  const int linear[] = {PoseBatch::TX, PoseBatch::TY, PoseBatch::TZ,
+                        PoseBatch::SX, PoseBatch::SY, PoseBatch::SZ};
+  size_t i = begin;
+  for (; i + L::N <= end; i += L::N) {
+    const V vt = t_step ? L::load(t + i) : L::set(*t);
+    const V vs = L::sub(one, vt);
+    for (int c : linear) {
+      L::store(out[c] + i,
+               mix<L>(L::load(from[c] + i), L::load(to[c] + i), vs, vt));
+    }
+
+    V a[4], b[4];
+    for (int c = 0; c < 4; c++) {
+      a[c] = L::load(from[PoseBatch::RX + c] + i);
+      b[c] = L::load(to[PoseBatch::RX + c] + i);
+    }
+    V cosine = L::mul(a[0], b[0]);
+    for (int c = 1; c < 4; c++) {
+      cosine = L::add(cosine, L::mul(a[c], b[c]));
+    }
+    // Take the shortest path: q and -q are the same rotation.
+    for (int c = 0; c < 4; c++) {
+      b[c] = L::flipSign(b[c], cosine);
+    }
+    cosine = L::flipSign(cosine, cosine);
+
+    V w0 = vs, w1 = vt;
+    if (slerp) {
+      float c[MAX_LANES], u[MAX_LANES], s0[MAX_LANES], s1[MAX_LANES];
+      L::store(c, cosine);
+      L::store(u, vt);
+      slerpWeights(c, u, s0, s1, L::N);
+      w0 = L::load(s0);
+      w1 = L::load(s1);
+    }
+    V q[4];
+    V length = L::set(0.0f);
+    for (int c = 0; c < 4; c++) {
+      q[c] = L::add(L::mul(a[c], w0), L::mul(b[c], w1));
+      length = L::add(length, L::mul(q[c], q[c]));
+    }
+    length = L::sqrt(length);
+    for (int c = 0; c < 4; c++) {
+      L::store(out[PoseBatch::RX + c] + i, L::div(q[c], length));
+    }
+  }
+  return i;
+}
+
+// Same expressions as glm::mat3_cast followed by scaling the columns.
+template <typename L>
+static size_t composeRange(Inputs p, glm::mat4 *matrices, size_t begin,
+                           size_t end) {
+  typedef typename L::V V;
+  const V one = L::set(1.0f), two = L::set(2.0f);
+  size_t i = begin;
+  for (; i + L::N <= end; i += L::N) {
+    const V x = L::load(p[PoseBatch::RX] + i);
+    const V y = L::load(p[PoseBatch::RY] + i);
+    const V z = L::load(p[PoseBatch::RZ] + i);
+    const V w = L::load(p[PoseBatch::RW] + i);
+    const V xx = L::mul(x, x), yy = L::mul(y, y), zz = L::mul(z, z);
+    const V xz = L::mul(x, z), xy = L::mul(x, y), yz = L::mul(y, z);
+    const V wx = L::mul(w, x), wy = L::mul(w, y), wz = L::mul(w, z);
+    const V sx = L::load(p[PoseBatch::SX] + i);
+    const V sy = L::load(p[PoseBatch::SY] + i);
+    const V sz = L::load(p[PoseBatch::SZ] + i);
+
+    V m[12];
+    m[0] = L::mul(L::sub(one, L::mul(two, L::add(yy, zz))), sx);
+    m[1] = L::mul(L::mul(two, L::add(xy, wz)), sx);
+    m[2] = L::mul(L::mul(two, L::sub(xz, wy)), sx);
+    m[3] = L::mul(L::mul(two, L::sub(xy, wz)), sy);
+    m[4] = L::mul(L::sub(one, L::mul(two, L::add(xx, zz))), sy);
+    m[5] = L::mul(L::mul(two, L::add(yz, wx)), sy);
+    m[6] = L::mul(L::mul(two, L::add(xz, wy)), sz);
+    m[7] = L::mul(L::mul(two, L::sub(yz, wx)), sz);
+    m[8] = L::mul(L::sub(one, L::mul(two, L::add(xx, yy))), sz);
+    m[9] = L::load(p[PoseBatch::TX] + i);
+    m[10] = L::load(p[PoseBatch::TY] + i);
+    m[11] = L::load(p[PoseBatch::TZ] + i);
+
+    // Transpose into column-major glm matrices.
+    float lanes[12][MAX_LANES];
+    for (int e = 0; e < 12; e++) {
+      L::store(lanes[e], m[e]);
+    }
+    for (size_t k = 0; k < L::N; k++) {
+      glm::mat4 &matrix = matrices[i + k];
+      for (int col = 0; col < 4; col++) {
+        for (int row = 0; row < 3; row++) {
+          matrix[col][row] = lanes[3 * col + row][k];
+        }
+        matrix[col][3] = col == 3 ? 1.0f : 0.0f;
+      }
+    }
+  }
+  return i;
+}
+
+////////////////////////////////////////////////////////////////////// PoseBatch
+
+PoseBatch::PoseBatch(size_t n_poses) : Size(0) { resize(n_poses); }
+
+void PoseBatch::resize(size_t n_poses) {
+  const float identity[COMPONENTS] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+                                      0.0f, 1.0f, 1.0f, 1.0f, 1.0f};
+  for (int c = 0; c < COMPONENTS; c++) {
+    Data[c].resize(n_poses, identity[c]);
+  }
+  Size = n_poses;
+}
+
+size_t PoseBatch::size() const { return Size; }
+
+float *PoseBatch::data(Component component) { return Data[component].data(); }
+
+const float *PoseBatch::data(Component component) const {
+  return Data[component].data();
+}
+
+void PoseBatch::set(size_t i, const Pose &pose) {
+  Data[TX][i] = pose.translation.x;
+  Data[TY][i] = pose.translation.y;
+  Data[TZ][i] = pose.translation.z;
+  Data[RX][i] = pose.rotation.x;
+  Data[RY][i] = pose.rotation.y;
+  Data[RZ][i] = pose.rotation.z;
+  Data[RW][i] = pose.rotation.w;
+  Data[SX][i] = pose.scale.x;
+  Data[SY][i] = pose.scale.y;
+  Data[SZ][i] = pose.scale.z;
+}
+
+Pose PoseBatch::get(size_t i) const {
+  return Pose(glm::vec3(Data[TX][i], Data[TY][i], Data[TZ][i]),
+              glm::quat(Data[RW][i], Data[RX][i], Data[RY][i], Data[RZ][i]),
+              glm::vec3(Data[SX][i], Data[SY][i], Data[SZ][i]));
+}
+
+void PoseBatch::blend(const PoseBatch &from, const PoseBatch &to, float t,
+                      PoseBatch &out, Rotation rotation) {
+  blendPoses(from, to, &t, 0, out, rotation);
+}
+
+void PoseBatch::blend(const PoseBatch &from, const PoseBatch &to,
+                      const float *t, PoseBatch &out, Rotation rotation) {
+  blendPoses(from, to, t, 1, out, rotation);
+}
+
+void PoseBatch::blendPoses(const PoseBatch &from, const PoseBatch &to,
+                           const float *t, size_t t_step, PoseBatch &out,
+                           Rotation rotation) {
+  const size_t n = std::min(from.Size, to.Size);
+  out.resize(n);
+  const float *in_from[COMPONENTS], *in_to[COMPONENTS];
+  float *result[COMPONENTS];
+  for (int c = 0; c < COMPONENTS; c++) {
+    in_from[c] = from.Data[c].data();
+    in_to[c] = to.Data[c].data();
+    result[c] = out.Data[c].data();
+  }
+  const bool slerp = rotation == SLERP;
+  size_t i = blendRange<WideLanes>(in_from, in_to, result, t, t_step, slerp,
+                                   0, n);
+  blendRange<ScalarLanes>(in_from, in_to, result, t, t_step, slerp, i, n);
+}
+
+void PoseBatch::compose(glm::mat4 *matrices) const {
+  const float *in[COMPONENTS];
+  for (int c = 0; c < COMPONENTS; c++) {
+    in[c] = Data[c].data();
+  }
+  size_t i = composeRange<WideLanes>(in, matrices, 0, Size);
+  composeRange<ScalarLanes>(in, matrices, i, Size);
+}
+
+const char *PoseBatch::getInstructionSet() {
+  return getSimdInstructionSet();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}  // namespace mgl
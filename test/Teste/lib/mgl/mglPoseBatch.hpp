@@ -0,0 +1,66 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Pose Batches (SIMD blending and composition)
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_POSE_BATCH_HPP
+#define MGL_POSE_BATCH_HPP
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "./mglPose.hpp"
+
+namespace mgl {
+
+class PoseBatch;
+
+////////////////////////////////////////////////////////////////////// PoseBatch
+
+// Many poses stored as one array per component, so that blending and matrix
+// composition run over several poses at once: 8 with AVX2, 4 with SSE2 and
+// one at a time otherwise. Results match blend() and Pose::toMatrix() within
+// float rounding; only the slerp weights (acos and sin) are computed per pose.
+
+class PoseBatch {
+ public:
+  enum Component { TX, TY, TZ, RX, RY, RZ, RW, SX, SY, SZ, COMPONENTS };
+  enum Rotation { NLERP, SLERP };
+
+  explicit PoseBatch(size_t n_poses = 0);
+  void resize(size_t n_poses);
+  size_t size() const;
+
+  void set(size_t i, const Pose &pose);
+  Pose get(size_t i) const;
+  float *data(Component component);
+  const float *data(Component component) const;
+
+  // out may be either input; it is resized to match them. The second form
+  // takes one weight per pose.
+  static void blend(const PoseBatch &from, const PoseBatch &to, float t,
+                    PoseBatch &out, Rotation rotation = SLERP);
+  static void blend(const PoseBatch &from, const PoseBatch &to,
+                    const float *t, PoseBatch &out, Rotation rotation = SLERP);
+  // matrices must hold size() elements.
+  void compose(glm::mat4 *matrices) const;
+
+  // "AVX2", "SSE2" or "scalar", as selected at compile time.
+  static const char *getInstructionSet();
+
+ private:
+  std::vector<float> Data[COMPONENTS];
+  size_t Size;
+
+  static void blendPoses(const PoseBatch &from, const PoseBatch &to,
+                         const float *t, size_t t_step, PoseBatch &out,
+                         Rotation rotation);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+}  // namespace mgl
+
+#endif /* MGL_POSE_BATCH_HPP */
@@ -0,0 +1,91 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Sorted Render Queue Class
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglRenderQueue.hpp"
+
+#include <cstring>
+
+namespace mgl {
+
+//////////////////////////////////////////////////////////////////// RenderQueue
+
+static uint64_t depthBits(float depth) {
+  if (!(depth > 0.0f)) {
+    return 0;  // behind the eye, or NaN
+  }
+  uint32_t bits;
+  std::memcpy(&bits, &depth, sizeof(bits));
+  return bits >> 7;  // sign bit is 0: keep the top 24 of 31
+}
+
+uint64_t RenderQueue::makeKey(unsigned int layer, bool transparent,
+                              uint32_t program, uint32_t material,
+                              uint32_t vao, uint32_t mesh, float depth) {
+  const uint64_t state = (static_cast<uint64_t>(program & 0x3FF) << 25) |
+                         (static_cast<uint64_t>(material & 0xFF) << 17) |
+                         (static_cast<uint64_t>(vao & 0xFF) << 9) |
+                         (mesh & 0x1FF);
+  uint64_t key = static_cast<uint64_t>(layer & (LAYERS - 1)) << 60;
+  if (transparent) {
+    key |= 1ull << 59;
+    key |= (~depthBits(depth) & 0xFFFFFF) << 35;
+    key |= state;
+  } else {
+    key |= state << 24;
+    key |= depthBits(depth);
+  }
+  return key;
+}
+
+unsigned int RenderQueue::getLayer(uint64_t key) {
+  return static_cast<unsigned int>(key >> 60);
+}
+
+bool RenderQueue::isTransparent(uint64_t key) { return (key >> 59) & 1; }
+
+void RenderQueue::push(uint64_t key, uint32_t index) {
+  Packets.push_back({key, index});
+}
+
+void RenderQueue::sort() {
+  const size_t n = Packets.size();
+  if (n < 2) {
+    return;
+  }
+  Scratch.resize(n);
+  for (unsigned int shift = 0; shift < 64; shift += 8) {
+    size_t count[256] = {};
+    for (const DrawPacket &p : Packets) {
+      count[(p.key >> shift) & 0xFF]++;
+    }
+    if (count[(Packets[0].key >> shift) & 0xFF] == n) {
+      continue;  // same byte everywhere
+    }
+    size_t offset = 0;
+    for (size_t &c : count) {
+      const size_t bucket = c;
+      c = offset;
+      offset += bucket;
+    }
+    for (const DrawPacket &p : Packets) {
+      Scratch[count[(p.key >> shift) & 0xFF]++] = p;
+    }
+    Packets.swap(Scratch);
+  }
+}
+
+void RenderQueue::clear() { Packets.clear(); }
+
+size_t RenderQueue::size() const { return Packets.size(); }
+
+const std::vector<DrawPacket> &RenderQueue::getPackets() const {
+  return Packets;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
@@ -0,0 +1,66 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Sorted Render Queue Class
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_RENDER_QUEUE_HPP
+#define MGL_RENDER_QUEUE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mgl {
+
+class RenderQueue;
+
+//////////////////////////////////////////////////////////////////// RenderQueue
+
+// Draw packets are a 64-bit sort key and the index of the draw they stand
+// for. sort() is a stable LSD radix sort on the key, one byte per pass,
+// skipping bytes that are equal in every key.
+//
+// Keys sort by layer first, then opaque before transparent. Opaque draws then
+// sort by program, material, vertex array and mesh, so that state changes
+// are few, and front-to-back within those. Transparent draws sort
+// back-to-front before anything else:
+//
+//   opaque       layer:4 0 program:10 material:8 vao:8 mesh:9 depth:24
+//   transparent  layer:4 1 ~depth:24 program:10 material:8 vao:8 mesh:9
+//
+// Ids are small integers (see the renderers); larger ids wrap, which only
+// costs some batching. Depth is the view-space distance, compared through
+// the bits of the positive float.
+
+struct DrawPacket {
+  uint64_t key;
+  uint32_t index;
+};
+
+class RenderQueue {
+public:
+  static const unsigned int LAYERS = 16;
+
+  static uint64_t makeKey(unsigned int layer, bool transparent,
+                          uint32_t program, uint32_t material, uint32_t vao,
+                          uint32_t mesh, float depth);
+  static unsigned int getLayer(uint64_t key);
+  static bool isTransparent(uint64_t key);
+
+  void push(uint64_t key, uint32_t index);
+  void sort();
+  void clear();
+  size_t size() const;
+  const std::vector<DrawPacket> &getPackets() const;
+
+private:
+  std::vector<DrawPacket> Packets, Scratch;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
+
+#endif /* MGL_RENDER_QUEUE_HPP */
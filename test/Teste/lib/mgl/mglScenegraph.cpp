@@ -0,0 +1,235 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Scene Management Class
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglScenegraph.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace mgl {
+
+///////////////////////////////////////////////////////////////////// SceneGraph
+
+SceneGraph::SceneGraph()
+    : FirstDirty(NO_PARENT), MeshNodes(0), BvhRebuild(false), BvhRefit(false) {}
+
+NodeId SceneGraph::addNode(NodeId parent) {
+  if (parent != NO_PARENT && parent >= Parents.size()) {
+    std::cerr << "[ERROR] Parent node " << parent << " does not exist"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  Parents.push_back(parent);
+  Translations.push_back(glm::vec3(0.0f));
+  Rotations.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+  Scales.push_back(glm::vec3(1.0f));
+  LocalMatrices.push_back(glm::mat4(1.0f));
+  WorldMatrices.push_back(glm::mat4(1.0f));
+  Dirty.push_back(0);
+  Moved.push_back(0);
+  Meshes.push_back(nullptr);
+  MeshBounds.push_back(BoundingBox());
+  Shaders.push_back(nullptr);
+  Colors.push_back(glm::vec3(1.0f));
+  Layers.push_back(0);
+  Transparent.push_back(0);
+  Occluders.push_back(0);
+  WorldBounds.resize(Parents.size());
+  Visible.push_back(1);
+  const NodeId node = static_cast<NodeId>(Parents.size() - 1);
+  setDirty(node);
+  return node;
+}
+
+void SceneGraph::reserve(size_t n_nodes) {
+  Parents.reserve(n_nodes);
+  Translations.reserve(n_nodes);
+  Rotations.reserve(n_nodes);
+  Scales.reserve(n_nodes);
+  LocalMatrices.reserve(n_nodes);
+  WorldMatrices.reserve(n_nodes);
+  Dirty.reserve(n_nodes);
+  Moved.reserve(n_nodes);
+  Meshes.reserve(n_nodes);
+  MeshBounds.reserve(n_nodes);
+  Shaders.reserve(n_nodes);
+  Colors.reserve(n_nodes);
+  Layers.reserve(n_nodes);
+  Transparent.reserve(n_nodes);
+  Occluders.reserve(n_nodes);
+  Visible.reserve(n_nodes);
+}
+
+size_t SceneGraph::size() const { return Parents.size(); }
+
+NodeId SceneGraph::getParent(NodeId node) const { return Parents[node]; }
+
+void SceneGraph::setDirty(NodeId node) {
+  Dirty[node] = 1;
+  FirstDirty = std::min(FirstDirty, node);
+}
+
+void SceneGraph::setTranslation(NodeId node, const glm::vec3 &translation) {
+  if (Translations[node] != translation) {
+    Translations[node] = translation;
+    setDirty(node);
+  }
+}
+
+void SceneGraph::setRotation(NodeId node, const glm::quat &rotation) {
+  if (Rotations[node] != rotation) {
+    Rotations[node] = rotation;
+    setDirty(node);
+  }
+}
+
+void SceneGraph::setScale(NodeId node, const glm::vec3 &scale) {
+  if (Scales[node] != scale) {
+    Scales[node] = scale;
+    setDirty(node);
+  }
+}
+
+const glm::vec3 &SceneGraph::getTranslation(NodeId node) const {
+  return Translations[node];
+}
+
+const glm::quat &SceneGraph::getRotation(NodeId node) const {
+  return Rotations[node];
+}
+
+const glm::vec3 &SceneGraph::getScale(NodeId node) const {
+  return Scales[node];
+}
+
+void SceneGraph::setPose(NodeId node, const Pose &pose) {
+  setTranslation(node, pose.translation);
+  setRotation(node, pose.rotation);
+  setScale(node, pose.scale);
+}
+
+Pose SceneGraph::getPose(NodeId node) const {
+  return Pose(Translations[node], Rotations[node], Scales[node]);
+}
+
+void SceneGraph::setColor(NodeId node, const glm::vec3 &color) {
+  Colors[node] = color;
+}
+
+void SceneGraph::setLayer(NodeId node, unsigned int layer) {
+  Layers[node] = static_cast<unsigned char>(layer);
+}
+
+void SceneGraph::setTransparent(NodeId node, bool transparent) {
+  Transparent[node] = transparent ? 1 : 0;
+}
+
+void SceneGraph::setOccluder(NodeId node, bool occluder) {
+  Occluders[node] = occluder ? 1 : 0;
+}
+
+const glm::mat4 &SceneGraph::getLocalMatrix(NodeId node) const {
+  return LocalMatrices[node];
+}
+
+const SceneGraph::Stats &SceneGraph::getStats() const { return Counters; }
+
+const glm::mat4 &SceneGraph::getWorldMatrix(NodeId node) const {
+  return WorldMatrices[node];
+}
+
+void SceneGraph::updateWorld() {
+  Counters.nodesVisited = 0;
+  Counters.localsUpdated = 0;
+  Counters.worldsUpdated = 0;
+  if (FirstDirty == NO_PARENT) {
+    return;
+  }
+  // Parents come first, so their world matrix is final by the time their
+  // children are visited. Nothing before the first dirty node can change,
+  // and the Moved flags of those nodes are stale and must not be read.
+  const NodeId first = FirstDirty;
+  const size_t n = Parents.size();
+  for (size_t i = first; i < n; i++) {
+    const NodeId parent = Parents[i];
+    const bool parent_moved =
+        parent != NO_PARENT && parent >= first && Moved[parent];
+    if (Dirty[i]) {
+      LocalMatrices[i] = composeMatrix(Translations[i], Rotations[i], Scales[i]);
+      Dirty[i] = 0;
+      Counters.localsUpdated++;
+    } else if (!parent_moved) {
+      Moved[i] = 0;
+      continue;
+    }
+    WorldMatrices[i] = parent == NO_PARENT
+                           ? LocalMatrices[i]
+                           : WorldMatrices[parent] * LocalMatrices[i];
+    if (Meshes[i]) {
+      WorldBounds.set(i, MeshBounds[i].transform(WorldMatrices[i]));
+      BvhRefit = true;
+    }
+    Moved[i] = 1;
+    Counters.worldsUpdated++;
+  }
+  Counters.nodesVisited = n - first;
+  FirstDirty = NO_PARENT;
+}
+
+BoundingBox SceneGraph::getWorldBoundingBox(NodeId node) const {
+  return WorldBounds.get(node);
+}
+
+void SceneGraph::cull(const Frustum &frustum) {
+  // Nodes without a mesh have empty boxes and are never visible.
+  Counters.visible = WorldBounds.cull(frustum, Visible);
+  Counters.culled = MeshNodes - Counters.visible;
+  Counters.cullTime = WorldBounds.getStats().cullTime;
+  Counters.occluded = 0;
+  Counters.occlusionTime = 0.0;
+}
+
+bool SceneGraph::isVisible(NodeId node) const { return Visible[node] != 0; }
+
+void SceneGraph::updateBvh() {
+  if (BvhRebuild) {
+    BvhNodes.clear();
+    for (size_t i = 0; i < Meshes.size(); i++) {
+      if (Meshes[i]) {
+        BvhNodes.push_back(static_cast<NodeId>(i));
+      }
+    }
+  } else if (!BvhRefit) {
+    return;
+  }
+  BvhBoxes.resize(BvhNodes.size());
+  for (size_t i = 0; i < BvhNodes.size(); i++) {
+    BvhBoxes[i] = WorldBounds.get(BvhNodes[i]);
+  }
+  if (!BvhRebuild) {
+    ObjectBvh.refit(BvhBoxes.data());
+  }
+  if (BvhRebuild || ObjectBvh.getCost() > 1.5f * ObjectBvh.getBuildCost()) {
+    ObjectBvh.build(BvhBoxes.data(), BvhBoxes.size());
+  }
+  BvhRebuild = false;
+  BvhRefit = false;
+}
+
+void SceneGraph::overlap(const BoundingBox &box, std::vector<NodeId> &nodes) {
+  updateBvh();
+  std::vector<uint32_t> primitives;
+  ObjectBvh.overlap(box, primitives);
+  for (const uint32_t primitive : primitives) {
+    nodes.push_back(BvhNodes[primitive]);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}  // namespace mgl
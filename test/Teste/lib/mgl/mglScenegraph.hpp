@@ -9,9 +9,22 @@
 #ifndef MGL_SCENEGRAPH_HPP
 #define MGL_SCENEGRAPH_HPP
 
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+
+#include "./mglBounds.hpp"
+#include "./mglBvh.hpp"
+#include "./mglOcclusion.hpp"
+#include "./mglPose.hpp"
+
 namespace mgl {
 
 class IDrawable;
+class SceneGraph;
+class IndirectRenderer;
+class Mesh;
+class ShaderProgram;
 
 ////////////////////////////////////////////////////////////////////// IDrawable
 
@@ -20,6 +33,120 @@ class IDrawable {
   virtual void draw(void) = 0;
 };
 
+///////////////////////////////////////////////////////////////////// SceneGraph
+
+// Nodes are stored as parallel arrays in topological order: a node is always
+// added after its parent, so world transforms are updated in one linear pass
+// over any hierarchy depth. Updating and drawing are separate passes; call
+// updateWorld() after changing transforms and before draw().
+//
+// Local and world matrices are cached. Setting a transform to its current
+// value changes nothing; otherwise only the node and its descendants are
+// recomputed, starting at the first changed node, so updating a static scene
+// costs almost nothing (see getStats()).
+//
+// World-space bounding boxes of the meshes are kept up to date by the same
+// pass. cull() tests them against a frustum, several boxes at a time (see
+// BoundsBatch), and draw() skips the nodes found outside; call it after
+// updateWorld(). Until the first cull() every node is drawn.
+//
+// raycast() and overlap() query the same boxes through a BVH, rebuilt when
+// meshes are set and refitted when they move; a refit that made queries
+// markedly slower than a fresh build triggers a rebuild.
+//
+// occlude() follows cull(): the visible occluder meshes (see setOccluder())
+// are rasterized by an OcclusionCuller and the other visible meshes whose
+// boxes are hidden behind them are not drawn either. Occluder meshes need
+// enableRaycast() for their triangles.
+
+typedef unsigned int NodeId;
+const NodeId NO_PARENT = ~0u;
+
+class SceneGraph {
+ public:
+  struct Stats {
+    size_t nodesVisited = 0;   // by the last updateWorld()
+    size_t localsUpdated = 0;  // local matrices recomposed
+    size_t worldsUpdated = 0;  // world matrices recomputed
+    size_t visible = 0;        // meshes inside the frustum, by the last cull()
+    size_t culled = 0;         // meshes outside it
+    double cullTime = 0.0;     // seconds in the last cull()
+    size_t occluded = 0;       // of the visible, hidden by the last occlude()
+    double occlusionTime = 0.0;  // seconds in the last occlude()
+  };
+
+  SceneGraph();
+  NodeId addNode(NodeId parent = NO_PARENT);
+  void reserve(size_t n_nodes);
+  size_t size() const;
+  NodeId getParent(NodeId node) const;
+
+  void setTranslation(NodeId node, const glm::vec3 &translation);
+  void setRotation(NodeId node, const glm::quat &rotation);
+  void setScale(NodeId node, const glm::vec3 &scale);
+  const glm::vec3 &getTranslation(NodeId node) const;
+  const glm::quat &getRotation(NodeId node) const;
+  const glm::vec3 &getScale(NodeId node) const;
+  void setPose(NodeId node, const Pose &pose);
+  Pose getPose(NodeId node) const;
+
+  // Nodes without a mesh only transform their children. The mesh's bounding
+  // box is taken now, so load the mesh first.
+  void setMesh(NodeId node, Mesh *mesh, ShaderProgram *shader);
+  void setColor(NodeId node, const glm::vec3 &color);
+  // Draw order of the node's mesh (see RenderQueue).
+  void setLayer(NodeId node, unsigned int layer);
+  void setTransparent(NodeId node, bool transparent);
+  void setOccluder(NodeId node, bool occluder);
+
+  void updateWorld();
+  const glm::mat4 &getLocalMatrix(NodeId node) const;
+  const glm::mat4 &getWorldMatrix(NodeId node) const;
+  // Empty for nodes without a mesh.
+  BoundingBox getWorldBoundingBox(NodeId node) const;
+  void cull(const Frustum &frustum);
+  // Call after cull(); visible reflects both passes afterwards.
+  void occlude(OcclusionCuller &culler, const glm::mat4 &view_projection);
+  bool isVisible(NodeId node) const;
+  // Nearest mesh hit by a world-space ray, tested against the mesh
+  // triangles (see Mesh::raycast()). distance is in units of ray.direction.
+  bool raycast(const Ray &ray, NodeId &node, float &distance);
+  // Appends the nodes whose world bounding boxes overlap the box.
+  void overlap(const BoundingBox &box, std::vector<NodeId> &nodes);
+  void draw(IndirectRenderer *renderer) const;
+  const Stats &getStats() const;
+
+ private:
+  std::vector<NodeId> Parents;
+  std::vector<glm::vec3> Translations;
+  std::vector<glm::quat> Rotations;
+  std::vector<glm::vec3> Scales;
+  std::vector<glm::mat4> LocalMatrices;
+  std::vector<glm::mat4> WorldMatrices;
+  std::vector<unsigned char> Dirty;  // local transform changed
+  std::vector<unsigned char> Moved;  // world changed in the last update
+  NodeId FirstDirty;
+  Stats Counters;
+
+  void setDirty(NodeId node);
+  std::vector<Mesh *> Meshes;
+  std::vector<BoundingBox> MeshBounds;  // object space, taken by setMesh()
+  std::vector<ShaderProgram *> Shaders;
+  std::vector<glm::vec3> Colors;
+  std::vector<unsigned char> Layers;
+  std::vector<unsigned char> Transparent;
+  std::vector<unsigned char> Occluders;
+  BoundsBatch WorldBounds;
+  std::vector<unsigned char> Visible;
+  size_t MeshNodes;
+  Bvh ObjectBvh;
+  std::vector<NodeId> BvhNodes;  // primitive to node
+  std::vector<BoundingBox> BvhBoxes;
+  bool BvhRebuild, BvhRefit;
+
+  void updateBvh();
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 }  // namespace mgl
 
@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Scene Management Class: meshes and drawing
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// The SceneGraph members that reach into Mesh and IndirectRenderer, kept apart
+// so that mglScenegraph.cpp builds without OpenGL or Assimp (see
+// bench/bench-scenegraph.cpp).
+
+#include "./mglScenegraph.hpp"
+
+#include <chrono>
+
+#include "./mglIndirectRenderer.hpp"
+#include "./mglMesh.hpp"
+
+namespace mgl {
+
+///////////////////////////////////////////////////////////////////// SceneGraph
+
+void SceneGraph::setMesh(NodeId node, Mesh *mesh, ShaderProgram *shader) {
+  MeshNodes -= Meshes[node] ? 1 : 0;
+  MeshNodes += mesh ? 1 : 0;
+  Meshes[node] = mesh;
+  Shaders[node] = shader;
+  // A pending world update recomputes the box again.
+  MeshBounds[node] = mesh ? mesh->getBoundingBox() : BoundingBox();
+  WorldBounds.set(node, MeshBounds[node].transform(WorldMatrices[node]));
+  BvhRebuild = true;
+}
+
+void SceneGraph::occlude(OcclusionCuller &culler,
+                         const glm::mat4 &view_projection) {
+  typedef std::chrono::steady_clock clock;
+  const clock::time_point start = clock::now();
+  const size_t n = Parents.size();
+  culler.begin(view_projection);
+  for (size_t i = 0; i < n; i++) {
+    if (Meshes[i] && Visible[i] && Occluders[i]) {
+      const std::vector<glm::vec3> &triangles = Meshes[i]->getTriangles();
+      culler.addOccluder(triangles.data(), triangles.size() / 3,
+                         WorldMatrices[i]);
+    }
+  }
+  culler.rasterize();
+  Counters.occluded = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (Meshes[i] && Visible[i] && !culler.isVisible(WorldBounds.get(i))) {
+      Visible[i] = 0;
+      Counters.occluded++;
+    }
+  }
+  Counters.visible -= Counters.occluded;
+  Counters.occlusionTime =
+      std::chrono::duration<double>(clock::now() - start).count();
+}
+
+bool SceneGraph::raycast(const Ray &ray, NodeId &node, float &distance) {
+  updateBvh();
+  Bvh::Hit hit;
+  const bool found = ObjectBvh.raycast(
+      ray, hit, [this](uint32_t primitive, const Ray &r) {
+        const NodeId n = BvhNodes[primitive];
+        // Affine transforms keep distances along the ray.
+        const Ray local = r.transform(glm::inverse(WorldMatrices[n]));
+        Bvh::Hit mesh_hit;
+        return Meshes[n]->raycast(local, mesh_hit) ? mesh_hit.distance : -1.0f;
+      });
+  if (found) {
+    node = BvhNodes[hit.primitive];
+    distance = hit.distance;
+  }
+  return found;
+}
+
+void SceneGraph::draw(IndirectRenderer *renderer) const {
+  const size_t n = Parents.size();
+  for (size_t i = 0; i < n; i++) {
+    if (Meshes[i] && Visible[i]) {
+      renderer->submit(Meshes[i], Shaders[i], WorldMatrices[i], Colors[i],
+                       Layers[i], Transparent[i] != 0);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}  // namespace mgl
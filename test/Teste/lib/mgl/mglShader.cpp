@@ -8,12 +8,70 @@
 
 #include "./mglShader.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <fstream>
+#include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <vector>
 
+#include "./mglState.hpp"
+
+#ifdef _WIN32
+#include <direct.h>
+#define MGL_MKDIR(dir) _mkdir(dir)
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#define MGL_MKDIR(dir) mkdir(dir, 0755)
+#endif
+
 namespace mgl {
 
+////////////////////////////////////////////////////////////////// BINARY CACHE
+
+// Cache files start with this header, followed by the program binary. The
+// key is stored to catch file name collisions.
+
+static const char CACHE_MAGIC[4] = {'M', 'G', 'L', 'P'};
+static const uint32_t CACHE_VERSION = 1;
+
+struct CacheHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t key;
+  uint32_t format;
+  uint32_t length;
+};
+
+static uint64_t hashString(const std::string &s,
+                           uint64_t hash = 14695981039346656037ull) {
+  for (const char c : s) {  // FNV-1a
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+static std::string glString(GLenum name) {
+  const GLubyte *s = glGetString(name);
+  return s ? reinterpret_cast<const char *>(s) : "";
+}
+
+static bool isParallelCompile() {
+  return GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
+}
+
+static bool isBinarySupported() {
+  if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary) {
+    return false;
+  }
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  return formats > 0;
+}
+
 ////////////////////////////////////////////////////////////////// ShaderProgram
 
 const std::string ShaderProgram::read(const std::string &filename) {
@@ -29,6 +87,22 @@ const std::string ShaderProgram::read(const std::string &filename) {
   return shader_string;
 }
 
+const std::string ShaderProgram::preprocess(const std::string &code) {
+  if (Defines.empty()) {
+    return code;
+  }
+  size_t version = code.find("#version");
+  if (version == std::string::npos) {
+    return Defines + "#line 1\n" + code;
+  }
+  const size_t eol = code.find('\n', version);
+  const size_t split = (eol == std::string::npos) ? code.size() : eol + 1;
+  const size_t line =
+      std::count(code.begin(), code.begin() + split, '\n') + 1;
+  return code.substr(0, split) + Defines + "#line " + std::to_string(line) +
+         "\n" + code.substr(split);
+}
+
 void ShaderProgram::checkCompilation(const GLuint shader_id,
                                      const std::string &filename) {
   GLint compiled;
@@ -56,24 +130,46 @@ void ShaderProgram::checkLinkage() {
   }
 }
 
-ShaderProgram::ShaderProgram() : ProgramId(glCreateProgram()) {}
+ShaderProgram::ShaderProgram()
+    : ProgramId(glCreateProgram()), Created(false), FromCache(false),
+      Linking(false), CreateTime(0.0) {}
 
 ShaderProgram::~ShaderProgram() {
-  glUseProgram(0);
-  glDeleteProgram(ProgramId);
+  State::getInstance().deleteProgram(ProgramId);
+}
+
+void ShaderProgram::addDefine(const std::string &define) {
+  Defines += "#define " + define + "\n";
+}
+
+void ShaderProgram::setCacheDirectory(const std::string &directory) {
+  CacheDirectory = directory;
 }
 
 void ShaderProgram::addShader(const GLenum shader_type,
                               const std::string &filename) {
-  const GLuint shader_id = glCreateShader(shader_type);
-  const std::string scode = read(filename);
-  const GLchar *code = scode.c_str();
-  glShaderSource(shader_id, 1, &code, 0);
-  glCompileShader(shader_id);
-  checkCompilation(shader_id, filename);
-  glAttachShader(ProgramId, shader_id);
+  Sources.push_back({shader_type, filename, preprocess(read(filename)), 0});
+}
 
-  Shaders[shader_type] = {shader_id};
+// Compile status is checked in finish(), so that compiles can overlap.
+void ShaderProgram::compile() {
+  static bool threads_set = false;
+  if (!threads_set && isParallelCompile()) {
+    if (GLEW_KHR_parallel_shader_compile) {
+      glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);  // implementation maximum
+    } else {
+      glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    }
+    threads_set = true;
+  }
+  for (Source &source : Sources) {
+    source.shader = glCreateShader(source.type);
+    const GLchar *code = source.code.c_str();
+    glShaderSource(source.shader, 1, &code, 0);
+    glCompileShader(source.shader);
+    glAttachShader(ProgramId, source.shader);
+    Shaders[source.type] = {source.shader};
+  }
 }
 
 void ShaderProgram::addAttribute(const std::string &name, const GLuint index) {
@@ -92,8 +188,31 @@ bool ShaderProgram::isAttribute(const std::string &name) {
 void ShaderProgram::addUniform(const std::string &name) {
   if (isUniform(name)) {
     std::cerr << "[WARNING] Uniform " << name << " already exists" << std::endl;
+    return;
   }
-  Uniforms[name] = {-1};
+  getSlot(name);
+}
+
+// Before create() every name is registered, to be resolved when linking.
+GLint ShaderProgram::getSlot(const std::string &name) {
+  auto i = Uniforms.find(name);
+  if (i != Uniforms.end()) {
+    return i->second.slot;
+  }
+  auto u = UnresolvedSlots.find(name);
+  if (u != UnresolvedSlots.end()) {
+    return u->second;
+  }
+  const GLint location =
+      Created ? glGetUniformLocation(ProgramId, name.c_str()) : -1;
+  const GLint slot = static_cast<GLint>(Slots.size());
+  Slots.push_back({location, false, {}});
+  if (Created && location < 0) {
+    UnresolvedSlots[name] = slot;
+  } else {
+    Uniforms[name] = {location, slot};
+  }
+  return slot;
 }
 
 bool ShaderProgram::isUniform(const std::string &name) {
@@ -114,29 +233,474 @@ bool ShaderProgram::isUniformBlock(const std::string &name) {
 }
 
 void ShaderProgram::create() {
-  glLinkProgram(ProgramId);
-  checkLinkage();
-  for (auto &i : Shaders) {
-    glDetachShader(ProgramId, i.second);
-    glDeleteShader(i.second);
+  createAsync();
+  if (!Created) {
+    finish();
+  }
+}
+
+void ShaderProgram::createAsync() {
+  typedef std::chrono::steady_clock clock;
+  const clock::time_point start = clock::now();
+  FromCache = readBinary();
+  if (!FromCache) {
+    compile();
+    if (!CacheDirectory.empty() && isBinarySupported()) {
+      glProgramParameteri(ProgramId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                          GL_TRUE);
+    }
+    glLinkProgram(ProgramId);
+    Linking = true;
   }
+  CreateTime += std::chrono::duration<double>(clock::now() - start).count();
+  if (FromCache) {
+    finish();
+  }
+}
 
-  for (auto &i : Uniforms) {
-    i.second.index = glGetUniformLocation(ProgramId, i.first.c_str());
-    if (i.second.index < 0)
-      std::cerr << "WARNING: Uniform " << i.first << " not found." << std::endl;
+bool ShaderProgram::isReady() {
+  if (Created) {
+    return true;
+  }
+  if (Linking && isParallelCompile()) {
+    GLint completed = GL_FALSE;
+    glGetProgramiv(ProgramId, GL_COMPLETION_STATUS_KHR, &completed);
+    if (completed == GL_FALSE) {
+      return false;
+    }
   }
+  finish();
+  return true;
+}
+
+void ShaderProgram::finish() {
+  typedef std::chrono::steady_clock clock;
+  const clock::time_point start = clock::now();
+  if (Linking) {
+    for (const Source &source : Sources) {
+      checkCompilation(source.shader, source.filename);
+    }
+    checkLinkage();
+    for (auto &i : Shaders) {
+      glDetachShader(ProgramId, i.second);
+      glDeleteShader(i.second);
+    }
+    writeBinary();
+    Linking = false;
+  }
+  Sources.clear();
+
+  for (auto i = Uniforms.begin(); i != Uniforms.end();) {
+    i->second.index = glGetUniformLocation(ProgramId, i->first.c_str());
+    Slots[i->second.slot] = {i->second.index, false, {}};
+    if (i->second.index < 0) {
+      std::cerr << "WARNING: Uniform " << i->first << " not found."
+                << std::endl;
+      UnresolvedSlots[i->first] = i->second.slot;
+      i = Uniforms.erase(i);
+    } else {
+      ++i;
+    }
+  }
+  Created = true;
   for (auto &i : Ubos) {
     i.second.index = glGetUniformBlockIndex(ProgramId, i.first.c_str());
     if (i.second.index == GL_INVALID_INDEX)
       std::cerr << "WARNING: UBO " << i.first << " not found." << std::endl;
-    glUniformBlockBinding(ProgramId, i.second.index, i.second.binding_point);
+    else
+      glUniformBlockBinding(ProgramId, i.second.index, i.second.binding_point);
+  }
+
+  introspect();
+  for (const ActiveUniform &u : ActiveUniforms) {
+    if (u.block < 0 && !isUniform(u.name)) {
+      getSlot(u.name);
+    }
+  }
+  for (const ActiveBlock &b : ActiveBlocks) {
+    Ubos[b.name] = {b.index, b.binding_point};
+  }
+  for (const ActiveAttribute &a : ActiveAttributes) {
+    Attributes[a.name] = {static_cast<GLuint>(a.location)};
   }
+
+  CreateTime += std::chrono::duration<double>(clock::now() - start).count();
+#ifdef DEBUG
+  std::cout << "Program " << ProgramId
+            << (FromCache ? " loaded from cache" : " compiled") << " in "
+            << CreateTime * 1000.0 << "ms" << std::endl;
+#endif
 }
 
-void ShaderProgram::bind() { glUseProgram(ProgramId); }
+bool ShaderProgram::isFromCache() const { return FromCache; }
+
+double ShaderProgram::getCreateTime() const { return CreateTime; }
+
+// Uniform block bindings are not part of the key: they are set after the
+// program is linked or loaded.
+std::string ShaderProgram::getCacheFilename(uint64_t &key) const {
+  key = hashString(glString(GL_VENDOR) + "\n" + glString(GL_RENDERER) + "\n" +
+                   glString(GL_VERSION) + "\n");
+  for (const Source &source : Sources) {
+    key = hashString(std::to_string(source.type) + "\n" + source.code, key);
+  }
+  for (auto &i : Attributes) {
+    key = hashString(i.first + ":" + std::to_string(i.second.index) + "\n",
+                     key);
+  }
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.prog",
+           static_cast<unsigned long long>(key));
+  return CacheDirectory + "/" + name;
+}
+
+bool ShaderProgram::readBinary() {
+  if (CacheDirectory.empty() || !isBinarySupported()) {
+    return false;
+  }
+  uint64_t key;
+  std::ifstream ifile(getCacheFilename(key), std::ios::binary);
+  if (!ifile.is_open()) {
+    return false;
+  }
+  CacheHeader header;
+  ifile.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!ifile.good() ||
+      std::string(header.magic, 4) != std::string(CACHE_MAGIC, 4) ||
+      header.version != CACHE_VERSION || header.key != key) {
+    return false;
+  }
+  std::vector<char> binary(header.length);
+  ifile.read(binary.data(), header.length);
+  if (!ifile.good()) {
+    return false;
+  }
+  glProgramBinary(ProgramId, header.format, binary.data(), header.length);
+  GLint linked = GL_FALSE;
+  glGetProgramiv(ProgramId, GL_LINK_STATUS, &linked);
+#ifdef DEBUG
+  if (linked == GL_FALSE) {
+    std::cout << "Program binary rejected by the driver, recompiling"
+              << std::endl;
+  }
+#endif
+  return linked == GL_TRUE;
+}
+
+void ShaderProgram::writeBinary() {
+  if (CacheDirectory.empty() || !isBinarySupported()) {
+    return;
+  }
+  GLint length = 0;
+  glGetProgramiv(ProgramId, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  glGetProgramBinary(ProgramId, length, &length, &format, binary.data());
+
+  CacheHeader header;
+  std::copy(CACHE_MAGIC, CACHE_MAGIC + 4, header.magic);
+  header.version = CACHE_VERSION;
+  header.format = format;
+  header.length = static_cast<uint32_t>(length);
+
+  MGL_MKDIR(CacheDirectory.c_str());
+  const std::string cachefile = getCacheFilename(header.key);
+  std::ofstream ofile(cachefile, std::ios::binary | std::ios::trunc);
+  if (!ofile.is_open()) {
+    std::cerr << "[WARNING] Failed to write program cache: " << cachefile
+              << std::endl;
+    return;
+  }
+  ofile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  ofile.write(binary.data(), length);
+}
+
+///////////////////////////////////////////////////////////////// INTROSPECTION
+
+static std::string baseName(const GLchar *name, GLsizei length) {
+  std::string base(name, length);
+  if (base.size() > 3 && base.compare(base.size() - 3, 3, "[0]") == 0) {
+    base.resize(base.size() - 3);
+  }
+  return base;
+}
+
+template <typename T> static bool byName(const T &a, const T &b) {
+  return a.name < b.name;
+}
+
+template <typename T>
+static const T *findByName(const std::vector<T> &table,
+                           const std::string &name) {
+  auto i = std::lower_bound(
+      table.begin(), table.end(), name,
+      [](const T &entry, const std::string &n) { return entry.name < n; });
+  return (i != table.end() && i->name == name) ? &*i : nullptr;
+}
+
+void ShaderProgram::introspect() {
+  ActiveUniforms.clear();
+  ActiveBlocks.clear();
+  ActiveAttributes.clear();
+  if (GLEW_VERSION_4_3 || GLEW_ARB_program_interface_query) {
+    introspectResources();
+  } else {
+    introspectLegacy();
+  }
+  std::sort(ActiveUniforms.begin(), ActiveUniforms.end(),
+            byName<ActiveUniform>);
+  std::sort(ActiveBlocks.begin(), ActiveBlocks.end(), byName<ActiveBlock>);
+  std::sort(ActiveAttributes.begin(), ActiveAttributes.end(),
+            byName<ActiveAttribute>);
+#ifdef DEBUG
+  std::cout << "Program " << ProgramId << ": " << ActiveUniforms.size()
+            << " uniforms, " << ActiveBlocks.size() << " blocks, "
+            << ActiveAttributes.size() << " attributes" << std::endl;
+#endif
+}
+
+// OpenGL 4.3 program interface query: one call per resource.
+void ShaderProgram::introspectResources() {
+  GLint count = 0, max_length = 0;
+  std::vector<GLchar> name;
+
+  glGetProgramInterfaceiv(ProgramId, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+  glGetProgramInterfaceiv(ProgramId, GL_UNIFORM, GL_MAX_NAME_LENGTH,
+                          &max_length);
+  name.resize(std::max(max_length, 1));
+  const GLenum uniform_props[] = {GL_TYPE,         GL_ARRAY_SIZE,
+                                  GL_LOCATION,     GL_BLOCK_INDEX,
+                                  GL_OFFSET,       GL_ARRAY_STRIDE,
+                                  GL_MATRIX_STRIDE};
+  for (GLint i = 0; i < count; i++) {
+    GLint v[7];
+    glGetProgramResourceiv(ProgramId, GL_UNIFORM, i, 7, uniform_props, 7,
+                           nullptr, v);
+    GLsizei length = 0;
+    glGetProgramResourceName(ProgramId, GL_UNIFORM, i, max_length, &length,
+                             name.data());
+    ActiveUniforms.push_back({baseName(name.data(), length),
+                              static_cast<GLenum>(v[0]), v[1], v[2], v[3], v[4],
+                              v[5], v[6]});
+  }
+
+  glGetProgramInterfaceiv(ProgramId, GL_UNIFORM_BLOCK, GL_ACTIVE_RESOURCES,
+                          &count);
+  glGetProgramInterfaceiv(ProgramId, GL_UNIFORM_BLOCK, GL_MAX_NAME_LENGTH,
+                          &max_length);
+  name.resize(std::max(max_length, 1));
+  const GLenum block_props[] = {GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE};
+  for (GLint i = 0; i < count; i++) {
+    GLint v[2];
+    glGetProgramResourceiv(ProgramId, GL_UNIFORM_BLOCK, i, 2, block_props, 2,
+                           nullptr, v);
+    GLsizei length = 0;
+    glGetProgramResourceName(ProgramId, GL_UNIFORM_BLOCK, i, max_length,
+                             &length, name.data());
+    ActiveBlocks.push_back({baseName(name.data(), length),
+                            static_cast<GLuint>(i), static_cast<GLuint>(v[0]),
+                            v[1]});
+  }
+
+  glGetProgramInterfaceiv(ProgramId, GL_PROGRAM_INPUT, GL_ACTIVE_RESOURCES,
+                          &count);
+  glGetProgramInterfaceiv(ProgramId, GL_PROGRAM_INPUT, GL_MAX_NAME_LENGTH,
+                          &max_length);
+  name.resize(std::max(max_length, 1));
+  const GLenum input_props[] = {GL_TYPE, GL_ARRAY_SIZE, GL_LOCATION};
+  for (GLint i = 0; i < count; i++) {
+    GLint v[3];
+    glGetProgramResourceiv(ProgramId, GL_PROGRAM_INPUT, i, 3, input_props, 3,
+                           nullptr, v);
+    if (v[2] < 0) {
+      continue; // built-in inputs such as gl_VertexID
+    }
+    GLsizei length = 0;
+    glGetProgramResourceName(ProgramId, GL_PROGRAM_INPUT, i, max_length,
+                             &length, name.data());
+    ActiveAttributes.push_back({baseName(name.data(), length),
+                                static_cast<GLenum>(v[0]), v[1], v[2]});
+  }
+}
+
+// OpenGL 3.3: glGetActiveUniform plus glGetActiveUniformsiv for the layout.
+void ShaderProgram::introspectLegacy() {
+  GLint count = 0, max_length = 0;
+  std::vector<GLchar> name;
+
+  glGetProgramiv(ProgramId, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(ProgramId, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+  name.resize(std::max(max_length, 1));
+  if (count > 0) {
+    std::vector<GLuint> indices(count);
+    for (GLint i = 0; i < count; i++) {
+      indices[i] = i;
+    }
+    std::vector<GLint> block(count), offset(count), array_stride(count),
+        matrix_stride(count);
+    glGetActiveUniformsiv(ProgramId, count, indices.data(),
+                          GL_UNIFORM_BLOCK_INDEX, block.data());
+    glGetActiveUniformsiv(ProgramId, count, indices.data(), GL_UNIFORM_OFFSET,
+                          offset.data());
+    glGetActiveUniformsiv(ProgramId, count, indices.data(),
+                          GL_UNIFORM_ARRAY_STRIDE, array_stride.data());
+    glGetActiveUniformsiv(ProgramId, count, indices.data(),
+                          GL_UNIFORM_MATRIX_STRIDE, matrix_stride.data());
+    for (GLint i = 0; i < count; i++) {
+      GLsizei length = 0;
+      GLint size = 0;
+      GLenum type = 0;
+      glGetActiveUniform(ProgramId, i, max_length, &length, &size, &type,
+                         name.data());
+      const GLint location =
+          block[i] < 0 ? glGetUniformLocation(ProgramId, name.data()) : -1;
+      ActiveUniforms.push_back({baseName(name.data(), length), type, size,
+                                location, block[i], offset[i], array_stride[i],
+                                matrix_stride[i]});
+    }
+  }
+
+  glGetProgramiv(ProgramId, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+  glGetProgramiv(ProgramId, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH,
+                 &max_length);
+  name.resize(std::max(max_length, 1));
+  for (GLint i = 0; i < count; i++) {
+    GLint binding = 0, size = 0;
+    glGetActiveUniformBlockiv(ProgramId, i, GL_UNIFORM_BLOCK_BINDING, &binding);
+    glGetActiveUniformBlockiv(ProgramId, i, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+    GLsizei length = 0;
+    glGetActiveUniformBlockName(ProgramId, i, max_length, &length,
+                                name.data());
+    ActiveBlocks.push_back({baseName(name.data(), length),
+                            static_cast<GLuint>(i),
+                            static_cast<GLuint>(binding), size});
+  }
+
+  glGetProgramiv(ProgramId, GL_ACTIVE_ATTRIBUTES, &count);
+  glGetProgramiv(ProgramId, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_length);
+  name.resize(std::max(max_length, 1));
+  for (GLint i = 0; i < count; i++) {
+    GLsizei length = 0;
+    GLint size = 0;
+    GLenum type = 0;
+    glGetActiveAttrib(ProgramId, i, max_length, &length, &size, &type,
+                      name.data());
+    const GLint location = glGetAttribLocation(ProgramId, name.data());
+    if (location < 0) {
+      continue; // built-in inputs such as gl_VertexID
+    }
+    ActiveAttributes.push_back(
+        {baseName(name.data(), length), type, size, location});
+  }
+}
+
+const std::vector<ShaderProgram::ActiveUniform> &
+ShaderProgram::getActiveUniforms() const {
+  return ActiveUniforms;
+}
+
+const std::vector<ShaderProgram::ActiveBlock> &
+ShaderProgram::getActiveBlocks() const {
+  return ActiveBlocks;
+}
+
+const std::vector<ShaderProgram::ActiveAttribute> &
+ShaderProgram::getActiveAttributes() const {
+  return ActiveAttributes;
+}
+
+const ShaderProgram::ActiveUniform *
+ShaderProgram::findUniform(const std::string &name) const {
+  return findByName(ActiveUniforms, name);
+}
+
+const ShaderProgram::ActiveBlock *
+ShaderProgram::findBlock(const std::string &name) const {
+  return findByName(ActiveBlocks, name);
+}
+
+const ShaderProgram::ActiveAttribute *
+ShaderProgram::findAttribute(const std::string &name) const {
+  return findByName(ActiveAttributes, name);
+}
+
+void ShaderProgram::checkType(const std::string &name, GLenum type) const {
+  const ActiveUniform *uniform = findUniform(name);
+  if (uniform && uniform->type != type) {
+    std::cerr << "[WARNING] Uniform " << name << " has type 0x" << std::hex
+              << uniform->type << ", handle has type 0x" << type << std::dec
+              << std::endl;
+  }
+}
+
+GLenum ShaderProgram::typeOf(const GLint *) { return GL_INT; }
+GLenum ShaderProgram::typeOf(const GLfloat *) { return GL_FLOAT; }
+GLenum ShaderProgram::typeOf(const glm::vec2 *) { return GL_FLOAT_VEC2; }
+GLenum ShaderProgram::typeOf(const glm::vec3 *) { return GL_FLOAT_VEC3; }
+GLenum ShaderProgram::typeOf(const glm::vec4 *) { return GL_FLOAT_VEC4; }
+GLenum ShaderProgram::typeOf(const glm::mat3 *) { return GL_FLOAT_MAT3; }
+GLenum ShaderProgram::typeOf(const glm::mat4 *) { return GL_FLOAT_MAT4; }
+
+// Matrix columns are matrixStride bytes apart (16 for mat3 in std140).
+void ShaderProgram::writeUniform(void *block, const ActiveUniform &uniform,
+                                 const glm::mat3 &value) {
+  unsigned char *column = static_cast<unsigned char *>(block) + uniform.offset;
+  const GLint stride = uniform.matrixStride > 0 ? uniform.matrixStride
+                                                : sizeof(glm::vec3);
+  for (int c = 0; c < 3; c++, column += stride) {
+    std::memcpy(column, &value[c], sizeof(glm::vec3));
+  }
+}
+
+void ShaderProgram::writeUniform(void *block, const ActiveUniform &uniform,
+                                 const glm::mat4 &value) {
+  unsigned char *column = static_cast<unsigned char *>(block) + uniform.offset;
+  const GLint stride = uniform.matrixStride > 0 ? uniform.matrixStride
+                                                : sizeof(glm::vec4);
+  for (int c = 0; c < 4; c++, column += stride) {
+    std::memcpy(column, &value[c], sizeof(glm::vec4));
+  }
+}
+
+void ShaderProgram::upload(GLint location, const GLint &value) {
+  glUniform1i(location, value);
+}
+
+void ShaderProgram::upload(GLint location, const GLfloat &value) {
+  glUniform1f(location, value);
+}
+
+void ShaderProgram::upload(GLint location, const glm::vec2 &value) {
+  glUniform2fv(location, 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::upload(GLint location, const glm::vec3 &value) {
+  glUniform3fv(location, 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::upload(GLint location, const glm::vec4 &value) {
+  glUniform4fv(location, 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::upload(GLint location, const glm::mat3 &value) {
+  glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void ShaderProgram::upload(GLint location, const glm::mat4 &value) {
+  glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void ShaderProgram::bind() {
+  if (!Created) {
+    finish();
+  }
+  State::getInstance().useProgram(ProgramId);
+}
 
-void ShaderProgram::unbind() { glUseProgram(0); }
+void ShaderProgram::unbind() { State::getInstance().useProgram(0); }
 
 ////////////////////////////////////////////////////////////////////////////////
 } // namespace mgl
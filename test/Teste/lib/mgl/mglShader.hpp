@@ -11,15 +11,59 @@
 
 #include <GL/glew.h>
 
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
 #include <map>
 #include <string>
+#include <vector>
 
 namespace mgl {
 
 class ShaderProgram;
 
+//////////////////////////////////////////////////////////////////////// Uniform
+
+// Typed handle to a uniform of one program. Handles are cheap to copy and
+// stay valid for the lifetime of the program; an unknown name yields a
+// handle whose set() does nothing.
+
+template <typename T> struct Uniform {
+  GLint slot = -1;
+};
+
 ////////////////////////////////////////////////////////////////// ShaderProgram
 
+// The name maps are for setting the program up. Per draw, use handles from
+// getUniform() and set(), with the program bound: set() skips the glUniform
+// call when the value is the one last set. Names the linked program does not
+// have are kept out of Uniforms, so isUniform() is false for them; their
+// handles are valid and set() ignores them.
+//
+// Shaders are compiled and linked in create(). With a cache directory set,
+// and OpenGL 4.1 or GL_ARB_get_program_binary, the linked binary is saved
+// there, keyed by a hash of the sources, attribute locations and the driver's
+// vendor, renderer and version strings, and later runs load it instead of
+// compiling. A binary the driver rejects is recompiled and replaced.
+//
+// createAsync() submits the compiles and the link without waiting for them,
+// so that the driver can work on many programs in parallel (more so with
+// GL_KHR_parallel_shader_compile) while the application goes on loading.
+// isReady() polls GL_COMPLETION_STATUS_KHR and finishes the program once it
+// has linked; without the extension it finishes it right away. bind() and
+// create() wait for a pending program.
+//
+// addDefine() adds a "#define NAME" or "#define NAME VALUE" line to the
+// shaders added after it, right after their #version line.
+//
+// create() introspects the linked program: every active uniform, uniform
+// block and attribute is listed, sorted by name, in the tables returned by
+// getActiveUniforms(), getActiveBlocks() and getActiveAttributes(), and is
+// added to the name maps if it was not registered by hand. Registering is
+// still needed to choose attribute locations and block binding points before
+// linking. Block members carry their byte offset and strides, so a block can
+// be filled in a mapped buffer with writeUniform() (see ActiveUniform).
+
 class ShaderProgram {
 public:
   GLuint ProgramId;
@@ -36,6 +80,7 @@ public:
 
   struct UniformInfo {
     GLint index;
+    GLint slot;
   };
   std::map<std::string, UniformInfo> Uniforms;
 
@@ -45,8 +90,36 @@ public:
   };
   std::map<std::string, UboInfo> Ubos;
 
+  // Uniforms of the default block have a location and block == -1. Members
+  // of a uniform block have location == -1 and their offset in the block.
+  // Arrays are named without the "[0]" suffix.
+  struct ActiveUniform {
+    std::string name;
+    GLenum type;
+    GLint size;
+    GLint location;
+    GLint block;
+    GLint offset;
+    GLint arrayStride;
+    GLint matrixStride;
+  };
+  struct ActiveBlock {
+    std::string name;
+    GLuint index;
+    GLuint binding_point;
+    GLint dataSize;
+  };
+  struct ActiveAttribute {
+    std::string name;
+    GLenum type;
+    GLint size;
+    GLint location;
+  };
+
   ShaderProgram();
   ~ShaderProgram();
+  void setCacheDirectory(const std::string &directory);
+  void addDefine(const std::string &define);
   void addShader(const GLenum shader_type, const std::string &filename);
   void addAttribute(const std::string &name, const GLuint index);
   bool isAttribute(const std::string &name);
@@ -55,15 +128,122 @@ public:
   void addUniformBlock(const std::string &name, const GLuint binding_point);
   bool isUniformBlock(const std::string &name);
   void create();
+  void createAsync();
+  bool isReady();
+  bool isFromCache() const;
+  double getCreateTime() const;  // seconds the calling thread spent creating
   void bind();
   void unbind();
 
+  template <typename T> Uniform<T> getUniform(const std::string &name);
+  template <typename T> void set(const Uniform<T> &uniform, const T &value);
+
+  const std::vector<ActiveUniform> &getActiveUniforms() const;
+  const std::vector<ActiveBlock> &getActiveBlocks() const;
+  const std::vector<ActiveAttribute> &getActiveAttributes() const;
+  const ActiveUniform *findUniform(const std::string &name) const;
+  const ActiveBlock *findBlock(const std::string &name) const;
+  const ActiveAttribute *findAttribute(const std::string &name) const;
+
+  // Writes a block member at its offset from the start of the block's data.
+  template <typename T>
+  static void writeUniform(void *block, const ActiveUniform &uniform,
+                           const T &value);
+  static void writeUniform(void *block, const ActiveUniform &uniform,
+                           const glm::mat3 &value);
+  static void writeUniform(void *block, const ActiveUniform &uniform,
+                           const glm::mat4 &value);
+
 private:
+  struct UniformSlot {
+    GLint location;
+    bool cached;
+    unsigned char value[sizeof(glm::mat4)];
+  };
+  std::vector<UniformSlot> Slots;
+  std::map<std::string, GLint> UnresolvedSlots;  // names not in the program
+  bool Created;
+  std::string Defines;
+  struct Source {
+    GLenum type;
+    std::string filename;
+    std::string code;
+    GLuint shader;
+  };
+  std::vector<Source> Sources;
+  std::string CacheDirectory;
+  bool FromCache, Linking;
+  double CreateTime;
+  std::vector<ActiveUniform> ActiveUniforms;
+  std::vector<ActiveBlock> ActiveBlocks;
+  std::vector<ActiveAttribute> ActiveAttributes;
+
+  void introspect();
+  void introspectResources();
+  void introspectLegacy();
+
+  GLint getSlot(const std::string &name);
+  void checkType(const std::string &name, GLenum type) const;
+  static GLenum typeOf(const GLint *);
+  static GLenum typeOf(const GLfloat *);
+  static GLenum typeOf(const glm::vec2 *);
+  static GLenum typeOf(const glm::vec3 *);
+  static GLenum typeOf(const glm::vec4 *);
+  static GLenum typeOf(const glm::mat3 *);
+  static GLenum typeOf(const glm::mat4 *);
+  static void upload(GLint location, const GLint &value);
+  static void upload(GLint location, const GLfloat &value);
+  static void upload(GLint location, const glm::vec2 &value);
+  static void upload(GLint location, const glm::vec3 &value);
+  static void upload(GLint location, const glm::vec4 &value);
+  static void upload(GLint location, const glm::mat3 &value);
+  static void upload(GLint location, const glm::mat4 &value);
+
   const std::string read(const std::string &filename);
+  const std::string preprocess(const std::string &code);
   void checkCompilation(const GLuint shader_id, const std::string &filename);
   void checkLinkage();
+  void compile();
+  void finish();
+  std::string getCacheFilename(uint64_t &key) const;
+  bool readBinary();
+  void writeBinary();
 };
 
+template <typename T>
+Uniform<T> ShaderProgram::getUniform(const std::string &name) {
+  Uniform<T> uniform;
+  uniform.slot = getSlot(name);
+#ifdef DEBUG
+  checkType(name, typeOf(static_cast<const T *>(nullptr)));
+#endif
+  return uniform;
+}
+
+template <typename T>
+void ShaderProgram::set(const Uniform<T> &uniform, const T &value) {
+  static_assert(sizeof(T) <= sizeof(UniformSlot::value),
+                "uniform type too large");
+  if (uniform.slot < 0) {
+    return;
+  }
+  UniformSlot &slot = Slots[uniform.slot];
+  if (slot.location < 0 ||
+      (slot.cached && std::memcmp(slot.value, &value, sizeof(T)) == 0)) {
+    return;
+  }
+  std::memcpy(slot.value, &value, sizeof(T));
+  slot.cached = true;
+  upload(slot.location, value);
+}
+
+template <typename T>
+void ShaderProgram::writeUniform(void *block, const ActiveUniform &uniform,
+                                 const T &value) {
+  std::memcpy(static_cast<unsigned char *>(block) + uniform.offset, &value,
+              sizeof(T));
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 } // namespace mgl
 
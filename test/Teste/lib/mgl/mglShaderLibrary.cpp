@@ -0,0 +1,165 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Shared Shader Program Library
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglShaderLibrary.hpp"
+
+#include <iostream>
+
+namespace mgl {
+
+////////////////////////////////////////////////////////////// ShaderDescription
+
+void ShaderDescription::addShader(const GLenum shader_type,
+                                  const std::string &filename) {
+  Shaders[shader_type] = filename;
+}
+
+void ShaderDescription::addDefine(const std::string &define) {
+  Defines.push_back(define);
+}
+
+void ShaderDescription::addAttribute(const std::string &name,
+                                     const GLuint index) {
+  Attributes[name] = index;
+}
+
+void ShaderDescription::addUniformBlock(const std::string &name,
+                                        const GLuint binding_point) {
+  Blocks[name] = binding_point;
+}
+
+std::string ShaderDescription::getKey() const {
+  std::string key;
+  for (auto &i : Shaders) {
+    key += "S" + std::to_string(i.first) + ":" + i.second + "\n";
+  }
+  for (auto &i : Defines) {
+    key += "D" + i + "\n";
+  }
+  for (auto &i : Attributes) {
+    key += "A" + i.first + ":" + std::to_string(i.second) + "\n";
+  }
+  for (auto &i : Blocks) {
+    key += "B" + i.first + ":" + std::to_string(i.second) + "\n";
+  }
+  return key;
+}
+
+void ShaderDescription::setup(ShaderProgram &program) const {
+  for (auto &i : Defines) {
+    program.addDefine(i);
+  }
+  for (auto &i : Shaders) {
+    program.addShader(i.first, i.second);
+  }
+  for (auto &i : Attributes) {
+    program.addAttribute(i.first, i.second);
+  }
+  for (auto &i : Blocks) {
+    program.addUniformBlock(i.first, i.second);
+  }
+}
+
+////////////////////////////////////////////////////////////////// ShaderLibrary
+
+std::shared_ptr<ShaderProgram>
+ShaderLibrary::get(const ShaderDescription &description) {
+  return get(description, false);
+}
+
+std::shared_ptr<ShaderProgram>
+ShaderLibrary::getAsync(const ShaderDescription &description) {
+  return get(description, true);
+}
+
+std::shared_ptr<ShaderProgram>
+ShaderLibrary::get(const ShaderDescription &description, bool async) {
+  Counters.requests++;
+  const std::string key = description.getKey();
+  auto i = Programs.find(key);
+  if (i != Programs.end()) {
+    std::shared_ptr<ShaderProgram> program = i->second.lock();
+    if (program) {
+      return program;
+    }
+  }
+  removeExpired();
+  std::shared_ptr<ShaderProgram> program = std::make_shared<ShaderProgram>();
+  program->setCacheDirectory(CacheDirectory);
+  description.setup(*program);
+  if (async) {
+    program->createAsync();
+  } else {
+    program->create();
+  }
+  Programs[key] = program;
+  Counters.created++;
+  if (program->isFromCache()) {
+    Counters.cacheHits++;
+  }
+  Counters.createTime += program->getCreateTime();
+  if (async && !program->isFromCache()) {
+    Pending.push_back({program, program->getCreateTime()});
+  }
+#ifdef DEBUG
+  std::cout << "Shader library: " << Counters.created << " program(s) for "
+            << Counters.requests << " request(s), " << Counters.cacheHits
+            << " from cache, " << Counters.createTime * 1000.0 << "ms"
+            << std::endl;
+#endif
+  return program;
+}
+
+void ShaderLibrary::setCacheDirectory(const std::string &directory) {
+  CacheDirectory = directory;
+}
+
+void ShaderLibrary::removeExpired() {
+  for (auto i = Programs.begin(); i != Programs.end();) {
+    if (i->second.expired()) {
+      i = Programs.erase(i);
+    } else {
+      ++i;
+    }
+  }
+}
+
+bool ShaderLibrary::isReady() {
+  bool ready = true;
+  for (auto &i : Programs) {
+    std::shared_ptr<ShaderProgram> program = i.second.lock();
+    if (program && !program->isReady()) {
+      ready = false;
+    }
+  }
+  // Time spent finishing async programs, here or in bind(), once linked.
+  for (auto i = Pending.begin(); i != Pending.end();) {
+    std::shared_ptr<ShaderProgram> program = i->first.lock();
+    if (program && !program->isReady()) {
+      ++i;
+      continue;
+    }
+    if (program) {
+      Counters.createTime += program->getCreateTime() - i->second;
+    }
+    i = Pending.erase(i);
+  }
+  return ready;
+}
+
+size_t ShaderLibrary::size() {
+  removeExpired();
+  return Programs.size();
+}
+
+const ShaderLibrary::Stats &ShaderLibrary::getStats() const {
+  return Counters;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
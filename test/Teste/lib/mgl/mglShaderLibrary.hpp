@@ -0,0 +1,98 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Shared Shader Program Library
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_SHADER_LIBRARY_HPP
+#define MGL_SHADER_LIBRARY_HPP
+
+#include <GL/glew.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "./mglShader.hpp"
+
+namespace mgl {
+
+class ShaderDescription;
+class ShaderLibrary;
+
+////////////////////////////////////////////////////////////// ShaderDescription
+
+// Everything a ShaderProgram is built from: shader files, defines, attribute
+// locations and uniform block binding points. Two descriptions with the same
+// key build the same program. Shader, attribute and block order does not
+// matter; define order does.
+
+class ShaderDescription {
+public:
+  void addShader(const GLenum shader_type, const std::string &filename);
+  void addDefine(const std::string &define);
+  void addAttribute(const std::string &name, const GLuint index);
+  void addUniformBlock(const std::string &name, const GLuint binding_point);
+
+  std::string getKey() const;
+  void setup(ShaderProgram &program) const;  // everything but create()
+
+private:
+  std::map<GLenum, std::string> Shaders;
+  std::vector<std::string> Defines;
+  std::map<std::string, GLuint> Attributes;
+  std::map<std::string, GLuint> Blocks;
+};
+
+////////////////////////////////////////////////////////////////// ShaderLibrary
+
+// Hands out shared programs: get() returns the live program built from an
+// equal description, or compiles and links a new one. The library only keeps
+// weak references, so a program is deleted when its last user releases it.
+// Draws sharing a program also share its glUseProgram in the renderers.
+// Programs are created with the library's binary cache directory, if any
+// (see ShaderProgram); Stats tells how many came from the cache and the time
+// spent creating programs, to compare startup with and without it.
+//
+// getAsync() creates new programs with ShaderProgram::createAsync(): request
+// every program first, then poll isReady() (true once all live programs have
+// linked) or just bind them, which waits. The time spent finishing them is
+// added to Stats::createTime by isReady(), once it sees them linked.
+
+class ShaderLibrary {
+public:
+  struct Stats {
+    size_t requests = 0;
+    size_t created = 0;    // programs compiled and linked or loaded
+    size_t cacheHits = 0;  // programs loaded from binaries
+    double createTime = 0.0;  // seconds creating and finishing programs
+  };
+
+  void setCacheDirectory(const std::string &directory);
+  std::shared_ptr<ShaderProgram> get(const ShaderDescription &description);
+  std::shared_ptr<ShaderProgram>
+  getAsync(const ShaderDescription &description);
+  bool isReady();
+  size_t size();
+  const Stats &getStats() const;
+
+private:
+  std::map<std::string, std::weak_ptr<ShaderProgram>> Programs;
+  std::string CacheDirectory;
+  Stats Counters;
+  // Async programs not yet seen linked, with the create time counted so far.
+  std::vector<std::pair<std::weak_ptr<ShaderProgram>, double>> Pending;
+
+  std::shared_ptr<ShaderProgram> get(const ShaderDescription &description,
+                                     bool async);
+  void removeExpired();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
+
+#endif /* MGL_SHADER_LIBRARY_HPP */
@@ -0,0 +1,121 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// SIMD Lanes (shared by the batch kernels)
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_SIMD_HPP
+#define MGL_SIMD_HPP
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MGL_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MGL_SIMD_SSE2
+#endif
+
+namespace mgl {
+
+////////////////////////////////////////////////////////////////////////// LANES
+
+// Kernels are written once over these wrappers and instantiated for the
+// widest vector available and for scalars, which handle the remainder.
+// Internal to the library: only included by translation units.
+
+struct ScalarLanes {
+  typedef float V;
+  static const size_t N = 1;
+  static float load(const float *p) { return *p; }
+  static void store(float *p, float v) { *p = v; }
+  static float set(float v) { return v; }
+  static float add(float a, float b) { return a + b; }
+  static float sub(float a, float b) { return a - b; }
+  static float mul(float a, float b) { return a * b; }
+  static float div(float a, float b) { return a / b; }
+  static float min(float a, float b) { return a < b ? a : b; }
+  static float max(float a, float b) { return a > b ? a : b; }
+  static float sqrt(float a) { return std::sqrt(a); }
+  // v negated where s has its sign bit set
+  static float flipSign(float v, float s) { return std::signbit(s) ? -v : v; }
+  // bit k set where a < b in lane k
+  static int lessMask(float a, float b) { return a < b ? 1 : 0; }
+};
+
+#ifdef MGL_SIMD_SSE2
+struct Sse2Lanes {
+  typedef __m128 V;
+  static const size_t N = 4;
+  static __m128 load(const float *p) { return _mm_loadu_ps(p); }
+  static void store(float *p, __m128 v) { _mm_storeu_ps(p, v); }
+  static __m128 set(float v) { return _mm_set1_ps(v); }
+  static __m128 add(__m128 a, __m128 b) { return _mm_add_ps(a, b); }
+  static __m128 sub(__m128 a, __m128 b) { return _mm_sub_ps(a, b); }
+  static __m128 mul(__m128 a, __m128 b) { return _mm_mul_ps(a, b); }
+  static __m128 div(__m128 a, __m128 b) { return _mm_div_ps(a, b); }
+  static __m128 min(__m128 a, __m128 b) { return _mm_min_ps(a, b); }
+  static __m128 max(__m128 a, __m128 b) { return _mm_max_ps(a, b); }
+  static __m128 sqrt(__m128 a) { return _mm_sqrt_ps(a); }
+  static __m128 flipSign(__m128 v, __m128 s) {
+    return _mm_xor_ps(v, _mm_and_ps(s, _mm_set1_ps(-0.0f)));
+  }
+  static int lessMask(__m128 a, __m128 b) {
+    return _mm_movemask_ps(_mm_cmplt_ps(a, b));
+  }
+};
+#endif
+
+#ifdef MGL_SIMD_AVX2
+struct Avx2Lanes {
+  typedef __m256 V;
+  static const size_t N = 8;
+  static __m256 load(const float *p) { return _mm256_loadu_ps(p); }
+  static void store(float *p, __m256 v) { _mm256_storeu_ps(p, v); }
+  static __m256 set(float v) { return _mm256_set1_ps(v); }
+  static __m256 add(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+  static __m256 sub(__m256 a, __m256 b) { return _mm256_sub_ps(a, b); }
+  static __m256 mul(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+  static __m256 div(__m256 a, __m256 b) { return _mm256_div_ps(a, b); }
+  static __m256 min(__m256 a, __m256 b) { return _mm256_min_ps(a, b); }
+  static __m256 max(__m256 a, __m256 b) { return _mm256_max_ps(a, b); }
+  static __m256 sqrt(__m256 a) { return _mm256_sqrt_ps(a); }
+  static __m256 flipSign(__m256 v, __m256 s) {
+    return _mm256_xor_ps(v, _mm256_and_ps(s, _mm256_set1_ps(-0.0f)));
+  }
+  static int lessMask(__m256 a, __m256 b) {
+    return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LT_OQ));
+  }
+};
+#endif
+
+#if defined(MGL_SIMD_AVX2)
+typedef Avx2Lanes WideLanes;
+#elif defined(MGL_SIMD_SSE2)
+typedef Sse2Lanes WideLanes;
+#else
+typedef ScalarLanes WideLanes;
+#endif
+
+const size_t MAX_LANES = 8;
+
+// "AVX2", "SSE2" or "scalar", as selected at compile time.
+inline const char *getSimdInstructionSet() {
+#if defined(MGL_SIMD_AVX2)
+  return "AVX2";
+#elif defined(MGL_SIMD_SSE2)
+  return "SSE2";
+#else
+  return "scalar";
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+}  // namespace mgl
+
+#endif /* MGL_SIMD_HPP */
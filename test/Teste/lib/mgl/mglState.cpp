@@ -0,0 +1,149 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// OpenGL State Cache Class
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglState.hpp"
+
+namespace mgl {
+
+////////////////////////////////////////////////////////////////////////// State
+
+State &State::getInstance() {
+  static State instance;
+  return instance;
+}
+
+State::State() : Program(UNKNOWN), VertexArray(UNKNOWN) {}
+
+bool State::change(GLuint &current, GLuint value) {
+  if (current == value) {
+    Counters.elided++;
+    return false;
+  }
+  current = value;
+  Counters.issued++;
+  return true;
+}
+
+void State::useProgram(GLuint program) {
+  if (change(Program, program)) {
+    glUseProgram(program);
+  }
+}
+
+void State::bindVertexArray(GLuint vao) {
+  if (change(VertexArray, vao)) {
+    glBindVertexArray(vao);
+    Buffers.erase(GL_ELEMENT_ARRAY_BUFFER);
+  }
+}
+
+void State::bindBuffer(GLenum target, GLuint buffer) {
+  auto i = Buffers.insert(std::make_pair(target, UNKNOWN)).first;
+  if (change(i->second, buffer)) {
+    glBindBuffer(target, buffer);
+  }
+}
+
+// Indexed binds also bind the generic target.
+void State::bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+  bindBufferRange(target, index, buffer, 0, 0);
+}
+
+void State::bindBufferRange(GLenum target, GLuint index, GLuint buffer,
+                            GLintptr offset, GLsizeiptr size) {
+  const Range range = {buffer, offset, size};
+  auto i = Ranges.find(std::make_pair(target, index));
+  if (i != Ranges.end() && i->second.buffer == buffer &&
+      i->second.offset == offset && i->second.size == size) {
+    Counters.elided++;
+    return;
+  }
+  Ranges[std::make_pair(target, index)] = range;
+  Buffers[target] = buffer;
+  Counters.issued++;
+  if (size == 0) {
+    glBindBufferBase(target, index, buffer);
+  } else {
+    glBindBufferRange(target, index, buffer, offset, size);
+  }
+}
+
+void State::enable(GLenum cap) {
+  auto i = Caps.find(cap);
+  if (i != Caps.end() && i->second) {
+    Counters.elided++;
+    return;
+  }
+  Caps[cap] = true;
+  Counters.issued++;
+  glEnable(cap);
+}
+
+void State::disable(GLenum cap) {
+  auto i = Caps.find(cap);
+  if (i != Caps.end() && !i->second) {
+    Counters.elided++;
+    return;
+  }
+  Caps[cap] = false;
+  Counters.issued++;
+  glDisable(cap);
+}
+
+void State::deleteProgram(GLuint program) {
+  if (Program == program) {
+    Program = UNKNOWN;
+  }
+  glDeleteProgram(program);
+}
+
+void State::deleteVertexArrays(GLsizei n, const GLuint *vaos) {
+  for (GLsizei i = 0; i < n; i++) {
+    if (VertexArray == vaos[i]) {
+      VertexArray = UNKNOWN;
+      Buffers.erase(GL_ELEMENT_ARRAY_BUFFER);
+    }
+  }
+  glDeleteVertexArrays(n, vaos);
+}
+
+void State::deleteBuffers(GLsizei n, const GLuint *buffers) {
+  for (GLsizei i = 0; i < n; i++) {
+    for (auto &b : Buffers) {
+      if (b.second == buffers[i]) {
+        b.second = UNKNOWN;
+      }
+    }
+    for (auto r = Ranges.begin(); r != Ranges.end();) {
+      if (r->second.buffer == buffers[i]) {
+        r = Ranges.erase(r);
+      } else {
+        ++r;
+      }
+    }
+  }
+  glDeleteBuffers(n, buffers);
+}
+
+void State::invalidate() {
+  Program = UNKNOWN;
+  VertexArray = UNKNOWN;
+  Buffers.clear();
+  Ranges.clear();
+  Caps.clear();
+}
+
+void State::endFrame() {
+  LastFrame = Counters;
+  Counters = Stats();
+}
+
+const State::Stats &State::getStats() const { return LastFrame; }
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// OpenGL State Cache Class
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_STATE_HPP
+#define MGL_STATE_HPP
+
+#include <GL/glew.h>
+
+#include <map>
+#include <utility>
+
+namespace mgl {
+
+class State;
+
+////////////////////////////////////////////////////////////////////////// State
+
+// Shadow copy of the bindings mgl classes use: program, vertex array, buffer
+// targets, indexed buffer binding points and enable caps. A call reaches the
+// driver only when it changes the shadowed value, so there is no need to
+// unbind after use. GL_ELEMENT_ARRAY_BUFFER belongs to the vertex array and
+// is forgotten when the vertex array changes.
+//
+// Every mgl class goes through State; code calling OpenGL directly must call
+// invalidate() afterwards. Objects must be deleted through State, so that a
+// new object reusing the name is not taken as already bound. Stats count the
+// calls issued and elided during the last frame (see endFrame(), called by
+// Engine::run()).
+
+class State {
+public:
+  struct Stats {
+    size_t issued = 0;
+    size_t elided = 0;
+  };
+
+  static State &getInstance();
+
+  void useProgram(GLuint program);
+  void bindVertexArray(GLuint vao);
+  void bindBuffer(GLenum target, GLuint buffer);
+  void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+  void bindBufferRange(GLenum target, GLuint index, GLuint buffer,
+                       GLintptr offset, GLsizeiptr size);
+  void enable(GLenum cap);
+  void disable(GLenum cap);
+
+  void deleteProgram(GLuint program);
+  void deleteVertexArrays(GLsizei n, const GLuint *vaos);
+  void deleteBuffers(GLsizei n, const GLuint *buffers);
+
+  void invalidate();
+  void endFrame();
+  const Stats &getStats() const;
+
+private:
+  State();
+
+  struct Range {
+    GLuint buffer;
+    GLintptr offset;
+    GLsizeiptr size;
+  };
+  static const GLuint UNKNOWN = ~0u;
+
+  GLuint Program;
+  GLuint VertexArray;
+  std::map<GLenum, GLuint> Buffers;
+  std::map<std::pair<GLenum, GLuint>, Range> Ranges;
+  std::map<GLenum, bool> Caps;
+  Stats Counters, LastFrame;
+
+  bool change(GLuint &current, GLuint value);
+
+public:
+  State(State const &) = delete;
+  void operator=(State const &) = delete;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
+
+#endif /* MGL_STATE_HPP */
@@ -0,0 +1,210 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Streaming Upload Buffer Class
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglStreamBuffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "./mglState.hpp"
+
+namespace mgl {
+
+/////////////////////////////////////////////////////////////////// StreamBuffer
+
+StreamBuffer::StreamBuffer(GLsizeiptr frame_size)
+    : BufferId(0), FrameSize(frame_size), Head(0), End(0),
+      Persistent(GLEW_ARB_buffer_storage != 0), FrameStarted(false),
+      Mapped(nullptr), Segment(0), Frame(0) {
+  GLint alignment = 0;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  Alignment = std::max<GLsizeiptr>(alignment, 16);
+  std::fill(Fences, Fences + FRAMES, nullptr);
+  createStorage();
+}
+
+void StreamBuffer::createStorage() {
+  // GL_COPY_WRITE_BUFFER leaves the bindings used for drawing untouched.
+  State &state = State::getInstance();
+  glGenBuffers(1, &BufferId);
+  state.bindBuffer(GL_COPY_WRITE_BUFFER, BufferId);
+  if (Persistent) {
+    const GLbitfield flags =
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_COPY_WRITE_BUFFER, FrameSize * FRAMES, nullptr, flags);
+    Mapped = static_cast<unsigned char *>(glMapBufferRange(
+        GL_COPY_WRITE_BUFFER, 0, FrameSize * FRAMES, flags));
+    if (Mapped == nullptr) {
+      std::cerr << "[WARNING] Persistent mapping failed, orphaning instead"
+                << std::endl;
+      state.deleteBuffers(1, &BufferId);
+      glGenBuffers(1, &BufferId);
+      state.bindBuffer(GL_COPY_WRITE_BUFFER, BufferId);
+      Persistent = false;
+    }
+  }
+  if (!Persistent) {
+    glBufferData(GL_COPY_WRITE_BUFFER, FrameSize, nullptr, GL_STREAM_DRAW);
+  }
+}
+
+StreamBuffer::~StreamBuffer() {
+  State &state = State::getInstance();
+  for (GLsync &fence : Fences) {
+    if (fence) glDeleteSync(fence);
+  }
+  if (Mapped) {
+    state.bindBuffer(GL_COPY_WRITE_BUFFER, BufferId);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+  }
+  state.deleteBuffers(1, &BufferId);
+  if (!Retired.empty()) {
+    state.deleteBuffers(static_cast<GLsizei>(Retired.size()), Retired.data());
+  }
+}
+
+bool StreamBuffer::isPersistent() const { return Persistent; }
+
+GLuint StreamBuffer::getBufferId() const { return BufferId; }
+
+GLsizeiptr StreamBuffer::getFrameSize() const { return FrameSize; }
+
+const StreamBuffer::Stats &StreamBuffer::getStats() const { return Counters; }
+
+void StreamBuffer::resetStats() { Counters = Stats(); }
+
+void StreamBuffer::beginSegment() {
+  // Nothing of the previous frame is bound or written anymore; the driver
+  // frees the storage once the GPU is done with it.
+  if (!Retired.empty()) {
+    State::getInstance().deleteBuffers(static_cast<GLsizei>(Retired.size()),
+                                       Retired.data());
+    Retired.clear();
+  }
+  if (Persistent) {
+    GLsync &fence = Fences[Segment];
+    if (fence) {
+      GLenum result = glClientWaitSync(fence, 0, 0);
+      if (result == GL_TIMEOUT_EXPIRED) {
+        Counters.fenceWaits++;
+        do {
+          result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                    1000000000);  // 1s
+        } while (result == GL_TIMEOUT_EXPIRED);
+      }
+      glDeleteSync(fence);
+      fence = nullptr;
+    }
+    Head = FrameSize * Segment;
+  } else {
+    State::getInstance().bindBuffer(GL_COPY_WRITE_BUFFER, BufferId);
+    glBufferData(GL_COPY_WRITE_BUFFER, FrameSize, nullptr, GL_STREAM_DRAW);
+    Counters.orphans++;
+    Head = 0;
+  }
+  End = Head + FrameSize;
+  FrameStarted = true;
+}
+
+// Switches to a new buffer in the middle of a frame. Ending the frame early
+// instead would fence draws not yet submitted and, when orphaning, leave the
+// frame's earlier allocations pointing at fresh storage.
+void StreamBuffer::grow(GLsizeiptr frame_size) {
+  State &state = State::getInstance();
+  if (Mapped) {
+    state.bindBuffer(GL_COPY_WRITE_BUFFER, BufferId);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    Mapped = nullptr;
+  }
+  Retired.push_back(BufferId);
+  // The fences guarded the old buffer; every segment of the new one is free.
+  for (GLsync &fence : Fences) {
+    if (fence) {
+      glDeleteSync(fence);
+      fence = nullptr;
+    }
+  }
+  FrameSize = std::max(FrameSize * 2, frame_size);
+  createStorage();
+  Segment = 0;
+  Head = 0;
+  End = FrameSize;
+  Counters.grows++;
+#ifdef DEBUG
+  std::cout << "Stream buffer grown to " << FrameSize << " bytes per frame"
+            << std::endl;
+#endif
+}
+
+StreamBuffer::Allocation StreamBuffer::write(const void *data, GLsizeiptr size,
+                                             GLsizeiptr alignment) {
+  if (!FrameStarted) {
+    beginSegment();
+  }
+  alignment = std::max(alignment, Alignment);
+  GLsizeiptr offset = (Head + alignment - 1) / alignment * alignment;
+  if (offset + size > End) {
+    // The frame needs what it wrote so far plus this allocation.
+    grow(offset - (End - FrameSize) + size);
+    offset = 0;
+  }
+
+  if (Persistent) {
+    std::memcpy(Mapped + offset, data, size);
+  } else {
+    State::getInstance().bindBuffer(GL_COPY_WRITE_BUFFER, BufferId);
+    void *ptr = glMapBufferRange(
+        GL_COPY_WRITE_BUFFER, offset, size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+            GL_MAP_UNSYNCHRONIZED_BIT);
+    std::memcpy(ptr, data, size);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+  }
+  Head = offset + size;
+  Counters.bytesStreamed += size;
+  Counters.allocations++;
+
+  Allocation allocation;
+  allocation.buffer = BufferId;
+  allocation.offset = offset;
+  allocation.size = size;
+  allocation.frame = Frame;
+  return allocation;
+}
+
+bool StreamBuffer::isValid(const Allocation &allocation) const {
+  // Only within the frame that wrote it: a segment's fence is created at the
+  // end of that frame, so it does not cover later frames still reading it.
+  // An orphaned buffer loses its contents at the next frame anyway, as do
+  // outgrown buffers.
+  if (allocation.frame != Frame) {
+    return false;
+  }
+  return allocation.buffer == BufferId ||
+         std::find(Retired.begin(), Retired.end(), allocation.buffer) !=
+             Retired.end();
+}
+
+void StreamBuffer::bindRange(GLenum target, GLuint index,
+                             const Allocation &allocation) {
+  State::getInstance().bindBufferRange(target, index, allocation.buffer,
+                                       allocation.offset, allocation.size);
+}
+
+void StreamBuffer::endFrame() {
+  if (Persistent && FrameStarted) {
+    Fences[Segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+  Segment = (Segment + 1) % FRAMES;
+  Frame++;
+  FrameStarted = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
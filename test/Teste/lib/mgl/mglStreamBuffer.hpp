@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Streaming Upload Buffer Class
+//
+// Copyright (c)2022-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_STREAM_BUFFER_HPP
+#define MGL_STREAM_BUFFER_HPP
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace mgl {
+
+class StreamBuffer;
+
+/////////////////////////////////////////////////////////////////// StreamBuffer
+
+// Ring buffer for data rewritten every frame (camera and per-object uniforms,
+// dynamic vertices). With GL_ARB_buffer_storage the buffer is persistently
+// mapped and split in FRAMES segments, each guarded by a fence so the CPU
+// never writes what the GPU may still read. Otherwise (OpenGL 3.3) the buffer
+// is orphaned at the start of every frame and written with unsynchronized
+// mappings. Call endFrame() once per frame, after the last draw using it.
+//
+// A frame that writes more than the frame size grows the ring: writing goes
+// on in a new buffer of twice the size, while the old one keeps the frame's
+// earlier allocations (and any ranges bound to them) until the next frame.
+// The frame size stays grown afterwards. Allocations are valid until the
+// frame ends, whatever buffer they are in, and must be written again in the
+// next frame.
+
+class StreamBuffer {
+public:
+  static const unsigned int FRAMES = 3;
+
+  struct Allocation {
+    GLuint buffer = 0;
+    GLintptr offset = 0;
+    GLsizeiptr size = 0;
+    unsigned long long frame = 0;
+  };
+  struct Stats {
+    size_t bytesStreamed = 0;
+    size_t allocations = 0;
+    size_t fenceWaits = 0;  // frames where the GPU was still busy
+    size_t orphans = 0;     // buffer re-specifications (fallback only)
+    size_t grows = 0;       // frames that outgrew the frame size
+  };
+
+  explicit StreamBuffer(GLsizeiptr frame_size);
+  ~StreamBuffer();
+  StreamBuffer(const StreamBuffer &) = delete;
+  StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+  Allocation write(const void *data, GLsizeiptr size,
+                   GLsizeiptr alignment = 0);
+  bool isValid(const Allocation &allocation) const;
+  void bindRange(GLenum target, GLuint index, const Allocation &allocation);
+  void endFrame();
+
+  bool isPersistent() const;
+  GLuint getBufferId() const;
+  GLsizeiptr getFrameSize() const;
+  const Stats &getStats() const;
+  void resetStats();
+
+private:
+  GLuint BufferId;
+  GLsizeiptr FrameSize;
+  GLsizeiptr Alignment;
+  GLsizeiptr Head, End;
+  bool Persistent, FrameStarted;
+  unsigned char *Mapped;
+  GLsync Fences[FRAMES];
+  unsigned int Segment;
+  unsigned long long Frame;
+  std::vector<GLuint> Retired;  // outgrown buffers, deleted next frame
+  Stats Counters;
+
+  void createStorage();
+  void beginSegment();
+  void grow(GLsizeiptr frame_size);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
+
+#endif /* MGL_STREAM_BUFFER_HPP */
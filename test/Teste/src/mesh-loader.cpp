@@ -9,10 +9,12 @@
 //
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <chrono>
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/transform.hpp>
-#include <glm/gtx/matrix_decompose.hpp>
+#include <iostream>
 
 #include "mgl/mgl.hpp"
 
@@ -21,19 +23,18 @@
 
 ////////////////////////////////////////////////////////////////////////// MYAPP
 
-class SceneNode {
+// One tangram piece: its crab and cube layouts, blended into a scene node
+class TangramPiece {
 public:
-    const GLuint UBO_BP = 0;
-    mgl::Mesh* mesh;
-    std::vector<SceneNode*> children;
+    mgl::Mesh* mesh = nullptr;
+    mgl::NodeId node = mgl::NO_PARENT;
     glm::mat4 TranslateMatrixCube = glm::mat4(1.0f);
     glm::mat4 TranslateMatrixCrab = glm::mat4(1.0f);
     glm::mat4 RotateMatrixCube = glm::mat4(1.0f);
     glm::mat4 RotateMatrixCrab = glm::mat4(1.0f);
     glm::mat4 ScaleMatrix = glm::mat4(1.0f);
-    mgl::ShaderProgram* Shader = nullptr;
-    SceneNode* parent = nullptr;
-    GLint ModelMatrixId;
+    mgl::Pose crab;
+    mgl::Pose cube;
 
     glm::vec3 color = glm::vec3(1.0f, 1.0f, 1.0f);
 
@@ -45,15 +46,6 @@ public:
         this->mesh = mesh;
     }
 
-    void addChild(SceneNode* child) {
-        child->parent = this;
-        children.push_back(child);
-    };
-
-    SceneNode* getChild(int index) {
-        return children[index];
-    }
-
     void translateCrab(glm::vec3 vector) {
         TranslateMatrixCrab = glm::translate(TranslateMatrixCrab, vector);
     };
@@ -71,122 +63,136 @@ public:
         ScaleMatrix = glm::scale(ScaleMatrix, vector);
     };
 
-    void draw(float progress) {
-        if (Shader != nullptr) {
-            glm::mat4 MatrixCrab = TranslateMatrixCrab * RotateMatrixCrab * ScaleMatrix;
-            glm::mat4 MatrixCube = TranslateMatrixCube * RotateMatrixCube * ScaleMatrix;
-            glm::mat4 worldMatrix;
+    // Decomposed once, after the layouts are set up
+    void createPoses() {
+        crab = mgl::Pose::fromMatrix(TranslateMatrixCrab * RotateMatrixCrab * ScaleMatrix);
+        cube = mgl::Pose::fromMatrix(TranslateMatrixCube * RotateMatrixCube * ScaleMatrix);
+    }
+};
 
-            if (parent != nullptr) {
-                glm::mat4 parentMatrixCrab = parent->TranslateMatrixCrab * parent->RotateMatrixCrab * parent->ScaleMatrix;
-                glm::mat4 parentMatrixCube = parent->TranslateMatrixCube * parent->RotateMatrixCube * parent->ScaleMatrix;
-                worldMatrix = interpolateMatrix(parentMatrixCrab, parentMatrixCube, progress) * interpolateMatrix(MatrixCrab, MatrixCube, progress);
-            }
-            else {
-                worldMatrix = interpolateMatrix(MatrixCrab, MatrixCube, progress);
+class Scene {
+public:
+    const GLuint UBO_BP = 0;
+    mgl::SceneGraph graph;
+    mgl::NodeId root = mgl::NO_PARENT;
+    std::vector<TangramPiece*> pieces;
+    mgl::Camera* camera;
+    mgl::IndirectRenderer* renderer = nullptr;
+    mgl::ShaderLibrary shaders;
+    std::vector<std::shared_ptr<mgl::ShaderProgram>> programs;
+    uint8_t cameraPos = 0;
+    uint8_t orto = 0;
+    uint8_t left = 0;
+    uint8_t right = 0;
+    uint8_t occlusion = 0;
+    size_t occluded = 0;
+    mgl::Animator animator;
+    mgl::OcclusionCuller occluder;
+
+    void setPieces(const std::vector<TangramPiece*>& tangram) {
+        pieces = tangram;
+        root = graph.addNode();
+        for (TangramPiece* piece : pieces) {
+            piece->node = graph.addNode(root);
+            graph.setColor(piece->node, piece->color);
+            graph.setOccluder(piece->node, true);
+        }
+    }
+    // Crab at the start of the clip, cube at the end
+    void createAnimation(float seconds) {
+        mgl::AnimationClip* morph = new mgl::AnimationClip("morph");
+        for (TangramPiece* piece : pieces) {
+            piece->createPoses();
+            morph->addPoseKeys(piece->node, { 0.0f, seconds }, { piece->crab, piece->cube },
+                mgl::EASE_IN_OUT);
+        }
+        animator.addClip(morph);
+        animator.setClip("morph");
+    }
+    void addCamera(mgl::Camera* Camera) {
+        this->camera = Camera;
+    }
+    void setRenderer(mgl::IndirectRenderer* Renderer) {
+        renderer = Renderer;
+    }
+    void draw(double elapsed) {
+        // Static frames touch no node (see graph.getStats())
+        animator.update(elapsed, graph);
+        graph.updateWorld();
+        const glm::mat4 viewProjection = camera->getProjectionMatrix() * camera->getViewMatrix();
+        graph.cull(mgl::Frustum(viewProjection));
+        if (occlusion) {
+            // Pieces hidden behind other pieces are not submitted
+            graph.occlude(occluder, viewProjection);
+#ifdef DEBUG
+            // Reported when the number of hidden pieces changes
+            const mgl::SceneGraph::Stats& stats = graph.getStats();
+            if (stats.occluded != occluded) {
+                occluded = stats.occluded;
+                const mgl::OcclusionCuller::Stats& passes = occluder.getStats();
+                std::cout << "Occluded " << stats.occluded << " of "
+                    << stats.occluded + stats.visible << " pieces in "
+                    << stats.occlusionTime * 1000.0 << " ms (setup "
+                    << passes.setupTime * 1000.0 << ", raster "
+                    << passes.rasterTime * 1000.0 << ", pyramid "
+                    << passes.pyramidTime * 1000.0 << ")" << std::endl;
             }
-
-            Shader->bind();  // Bind the shader program
-            glUniformMatrix4fv(ModelMatrixId, 1, GL_FALSE, glm::value_ptr(worldMatrix));
-            glUniform3fv(Shader->Uniforms["meshColor"].index, 1, glm::value_ptr(color));
-            // Draw the mesh
-            mesh->draw();
-            Shader->unbind();  // Unbind the shader program
+#endif
         }
-
-        if (children.size() != 0) {
-            // Recursively draw all children nodes
-            for (SceneNode* child : children) {
-                child->draw(progress);
+        renderer->setViewMatrix(camera->getViewMatrix());
+        graph.draw(renderer);
+        renderer->flush();
+    }
+    // Index of the piece nearest along the ray, or -1
+    int pick(const mgl::Ray& ray) {
+        mgl::NodeId node;
+        float distance;
+        if (graph.raycast(ray, node, distance)) {
+            for (size_t i = 0; i < pieces.size(); i++) {
+                if (pieces[i]->node == node) {
+                    return static_cast<int>(i);
+                }
             }
         }
-        TranslateMatrixCrab = glm::mat4(1.0f);
-        TranslateMatrixCube = glm::mat4(1.0f);
-        RotateMatrixCrab = glm::mat4(1.0f);
-        RotateMatrixCube = glm::mat4(1.0f);
-        ScaleMatrix = glm::mat4(1.0f);
+        return -1;
     }
-
+    // Pieces whose meshes have the same attributes share one program
     void createShaderProgram() {
-        if (children.size() != 0) {
-            for (SceneNode* child : children) {
-                child->createShaderProgram();
+        shaders.setCacheDirectory("cache");
+        const bool indirect = renderer->isIndirect();
+        for (TangramPiece* piece : pieces) {
+            mgl::Mesh* mesh = piece->mesh;
+            mgl::ShaderDescription Description;
+            // Model matrix and color come from the renderer's draw data
+            if (indirect) {
+                Description.addShader(GL_VERTEX_SHADER, "cube-mdi-vs.glsl");
+            } else {
+                Description.addShader(GL_VERTEX_SHADER, "cube-instanced-vs.glsl");
             }
-        }
-        if (mesh != nullptr) {
-            Shader = new mgl::ShaderProgram();
-            Shader->addShader(GL_VERTEX_SHADER, "cube-vs.glsl");
-            Shader->addShader(GL_FRAGMENT_SHADER, "cube-fs.glsl");
+            Description.addShader(GL_FRAGMENT_SHADER, "cube-instanced-fs.glsl");
 
-            Shader->addAttribute(mgl::POSITION_ATTRIBUTE, mgl::Mesh::POSITION);
+            Description.addAttribute(mgl::POSITION_ATTRIBUTE, mgl::Mesh::POSITION);
             if (mesh->hasNormals()) {
-                Shader->addAttribute(mgl::NORMAL_ATTRIBUTE, mgl::Mesh::NORMAL);
+                Description.addAttribute(mgl::NORMAL_ATTRIBUTE, mgl::Mesh::NORMAL);
             }
             if (mesh->hasTexcoords()) {
-                Shader->addAttribute(mgl::TEXCOORD_ATTRIBUTE, mgl::Mesh::TEXCOORD);
+                Description.addAttribute(mgl::TEXCOORD_ATTRIBUTE, mgl::Mesh::TEXCOORD);
             }
             if (mesh->hasTangentsAndBitangents()) {
-                Shader->addAttribute(mgl::TANGENT_ATTRIBUTE, mgl::Mesh::TANGENT);
+                Description.addAttribute(mgl::TANGENT_ATTRIBUTE, mgl::Mesh::TANGENT);
             }
 
-            Shader->addUniform("meshColor");
-            Shader->addUniform(mgl::MODEL_MATRIX);
-            Shader->addUniformBlock(mgl::CAMERA_BLOCK, UBO_BP);
-            Shader->create();
-            GLuint ModelMatrixId = Shader->Uniforms[mgl::MODEL_MATRIX].index;
-        }
-
-    }
-
-    glm::mat4 interpolateMatrix(const glm::mat4& CrabMat, const glm::mat4& CubeMat, float progress) {
-        // Decompose the start and end matrices into translation, rotation, and scale
-        glm::vec3 startTranslation, endTranslation, startScale, endScale, startSkew, endSkew;
-        glm::vec4 startPerspective, endPerspective;
-        glm::quat startRotation, endRotation;
-
-        // Decompose both matrices
-        glm::decompose(CrabMat, startScale, startRotation, startTranslation, startSkew, endPerspective);
-        glm::decompose(CubeMat, endScale, endRotation, endTranslation, endSkew, startPerspective);
-
-        // Interpolate translation, rotation, and scale
-        glm::vec3 interpolatedTranslation = glm::mix(startTranslation, endTranslation, progress);
-        glm::quat interpolatedRotation = glm::slerp(startRotation, endRotation, progress);
-        glm::vec3 interpolatedScale = glm::mix(startScale, endScale, progress);
-
-        // Reconstruct the final matrix with the interpolated components
-        glm::mat4 translationMat = glm::translate(glm::mat4(1.0f), interpolatedTranslation);
-        glm::mat4 rotationMat = glm::mat4_cast(interpolatedRotation);
-        glm::mat4 scaleMat = glm::scale(glm::mat4(1.0f), interpolatedScale);
-
-        return translationMat * rotationMat * scaleMat;
-    }
-
-
-};
-
-class SceneGraph {
-public:
-    SceneNode* root = nullptr;
-    mgl::Camera* camera;
-    uint8_t cameraPos = 0;
-    uint8_t orto = 0;
-    uint8_t left = 0;
-    uint8_t right = 0;
+            if (!indirect) {
+                Description.addAttribute(mgl::INSTANCE_MATRIX_ATTRIBUTE, mgl::Mesh::INSTANCE_MATRIX);
+                Description.addAttribute(mgl::INSTANCE_COLOR_ATTRIBUTE, mgl::Mesh::INSTANCE_COLOR);
+            }
+            Description.addUniformBlock(mgl::CAMERA_BLOCK, UBO_BP);
 
-    void setRootNode(SceneNode* rootNode) {
-        root = rootNode;
-    }
-    void addCamera(mgl::Camera* Camera) {
-        this->camera = Camera;
-    }
-    void draw(float progress) {
-        if (root != nullptr) {
-            root->draw(progress);
+            std::shared_ptr<mgl::ShaderProgram> Shader = shaders.getAsync(Description);
+            programs.push_back(Shader);
+            graph.setMesh(piece->node, mesh, Shader.get());
         }
     }
-    void createShaderProgram() {
-        root->createShaderProgram();
-    }
 };
 
 class MyApp : public mgl::App {
@@ -198,23 +204,28 @@ public:
     void displayCallback(GLFWwindow* win, double elapsed) override;
     void windowSizeCallback(GLFWwindow* win, int width, int height) override;
     void scrollCallback(GLFWwindow* win, double xpos, double ypos) override;
-    float progress = 0.0f;
 
 private:
     bool pressing = false;
     double cursor_x_pos;
     double cursor_y_pos;
+    int picked = -1;
     mgl::ShaderProgram* Shaders = nullptr;
     std::vector<mgl::Camera*> Cameras;
+    mgl::StreamBuffer* Stream = nullptr;
+    mgl::IndirectRenderer* Renderer = nullptr;
     mgl::Mesh* Mesh = nullptr;
+    mgl::MeshArena* Arena = nullptr;
     std::vector<mgl::Mesh*> tangramMeshes;
-    SceneGraph scene;
-    SceneNode tangram;
+    Scene scene;
+    std::vector<TangramPiece*> tangram;
 
     void createMeshes();
+    void createLayouts();
     void createShaderPrograms();
     void createCameras();
-    void drawScene();
+    void drawScene(double elapsed);
+    void pick(GLFWwindow* win, double xpos, double ypos);
 };
 
 ///////////////////////////////////////////////////////////////////////// MESHES
@@ -226,21 +237,34 @@ void MyApp::createMeshes() {
                                             "Para.obj",
                                             "TriangleFix.obj" };
 
+    Arena = new mgl::MeshArena();
+    mgl::MeshLoader loader;
     for (const std::string& file : mesh_files) {
         std::string mesh_fullname = mesh_dir + file;
         Mesh = new mgl::Mesh();
         Mesh->joinIdenticalVertices();
-        Mesh->create(mesh_fullname);
+        Mesh->optimize();
+        Mesh->enableRaycast();
+        Mesh->setCacheDirectory("cache");
+        Mesh->setVertexLayout(mgl::Mesh::INTERLEAVED);
+        Mesh->setArena(Arena);
+        loader.add(Mesh, mesh_fullname);
         tangramMeshes.push_back(Mesh);
     }
+    if (!loader.load()) {
+        for (const std::string& error : loader.getErrors()) {
+            std::cerr << "Error while loading: " << error << std::endl;
+        }
+        exit(EXIT_FAILURE);
+    }
 
-    SceneNode* Triangle1 = new SceneNode();
-    SceneNode* Triangle2 = new SceneNode();
-    SceneNode* Triangle3 = new SceneNode();
-    SceneNode* Triangle4 = new SceneNode();
-    SceneNode* Triangle5 = new SceneNode();
-    SceneNode* Para = new SceneNode();
-    SceneNode* Square = new SceneNode();
+    TangramPiece* Triangle1 = new TangramPiece();
+    TangramPiece* Triangle2 = new TangramPiece();
+    TangramPiece* Triangle3 = new TangramPiece();
+    TangramPiece* Triangle4 = new TangramPiece();
+    TangramPiece* Triangle5 = new TangramPiece();
+    TangramPiece* Para = new TangramPiece();
+    TangramPiece* Square = new TangramPiece();
 
     Triangle1->setMesh(tangramMeshes[2]);
     Triangle2->setMesh(tangramMeshes[2]);
@@ -258,19 +282,22 @@ void MyApp::createMeshes() {
     Para->setColor(glm::vec3(0.5f, 0.0f, 0.5f)); // Purple
     Square->setColor(glm::vec3(0.0f, 1.0f, 1.0f)); // Cyan
 
-    tangram.addChild(Triangle1);
-    tangram.addChild(Triangle2);
-    tangram.addChild(Triangle3);
-    tangram.addChild(Triangle4);
-    tangram.addChild(Triangle5);
-    tangram.addChild(Para);
-    tangram.addChild(Square);
+    tangram.push_back(Triangle1);
+    tangram.push_back(Triangle2);
+    tangram.push_back(Triangle3);
+    tangram.push_back(Triangle4);
+    tangram.push_back(Triangle5);
+    tangram.push_back(Para);
+    tangram.push_back(Square);
+    scene.setPieces(tangram);
 
 }
 
 ///////////////////////////////////////////////////////////////////////// SHADER
 
 void MyApp::createShaderPrograms() {
+    Renderer = new mgl::IndirectRenderer(Stream);
+    scene.setRenderer(Renderer);
     scene.createShaderProgram();
 }
 
@@ -295,7 +322,9 @@ glm::mat4 ProjectionMatrix2 =
 glm::perspective(glm::radians(30.0f), 640.0f / 480.0f, 1.0f, 10.0f);
 
 void MyApp::createCameras() {
+    Stream = new mgl::StreamBuffer(64 * 1024);
     mgl::Camera* Camera = new mgl::Camera(0);
+    Camera->setStreamBuffer(Stream);
     Camera->setViewMatrix(ViewMatrix1);
     Camera->setProjectionMatrix(ProjectionMatrix1);
     scene.addCamera(Camera);
@@ -309,6 +338,7 @@ glm::vec3 RotateAxisY = glm::vec3(0.0f, 1.0f, 0.0f);
 glm::vec3 RotateAxisZ = glm::vec3(0.0f, 0.0f, 1.0f);
 glm::vec3 TriangleBigScale = glm::vec3(1.0f, 2.0f, 2.0f);
 glm::vec3 TriangleMidScale = glm::vec3(1.0f, glm::sqrt(2), glm::sqrt(2));
+float MorphSeconds = 1.5f;
 
 /////////////////////////////////////////////////////////////////////////// CRAB
 
@@ -336,65 +366,60 @@ glm::vec3 Triangle5Translate2 = glm::vec3(-0.35f, 0.0f, 0.35f);
 //Para
 glm::vec3 ParaTranslate2 = glm::vec3(-0.485f, 0.0f, 0.49f);
 
-void MyApp::drawScene() {
+void MyApp::createLayouts() {
     //Big Triangles
-    tangram.getChild(0)->scale(TriangleBigScale);
-    tangram.getChild(1)->scale(TriangleBigScale);
+    tangram[0]->scale(TriangleBigScale);
+    tangram[1]->scale(TriangleBigScale);
     //Crab
-    tangram.getChild(0)->rotateCrab(-90.0f, RotateAxisX);
-    tangram.getChild(1)->rotateCrab(90.0f, RotateAxisX);
-    tangram.getChild(0)->translateCrab(Triangle1Translate);
-    tangram.getChild(1)->translateCrab(Triangle2Translate);
+    tangram[0]->rotateCrab(-90.0f, RotateAxisX);
+    tangram[1]->rotateCrab(90.0f, RotateAxisX);
+    tangram[0]->translateCrab(Triangle1Translate);
+    tangram[1]->translateCrab(Triangle2Translate);
     //Cube
-    tangram.getChild(0)->rotateCube(45.0f, RotateAxisY);
-    tangram.getChild(0)->rotateCube(90.0f, RotateAxisZ);
-    tangram.getChild(1)->rotateCube(-45.0f, RotateAxisY);
-    tangram.getChild(1)->rotateCube(90.0f, RotateAxisZ);
-    tangram.getChild(0)->translateCube(Triangle1Translate2);
-    tangram.getChild(1)->translateCube(Triangle2Translate2);
+    tangram[0]->rotateCube(45.0f, RotateAxisY);
+    tangram[0]->rotateCube(90.0f, RotateAxisZ);
+    tangram[1]->rotateCube(-45.0f, RotateAxisY);
+    tangram[1]->rotateCube(90.0f, RotateAxisZ);
+    tangram[0]->translateCube(Triangle1Translate2);
+    tangram[1]->translateCube(Triangle2Translate2);
     ////Mid Triangle
-    tangram.getChild(2)->scale(TriangleMidScale);
+    tangram[2]->scale(TriangleMidScale);
     //Crab
-    tangram.getChild(2)->rotateCrab(135.0f, RotateAxisX);
-    tangram.getChild(2)->translateCrab(TriangleMidTranslate);
+    tangram[2]->rotateCrab(135.0f, RotateAxisX);
+    tangram[2]->translateCrab(TriangleMidTranslate);
     //Cube
-    tangram.getChild(2)->rotateCube(90.0f, RotateAxisZ);
-    tangram.getChild(2)->translateCube(TriangleMidTranslate2);
+    tangram[2]->rotateCube(90.0f, RotateAxisZ);
+    tangram[2]->translateCube(TriangleMidTranslate2);
     ////Tiny Triangles
     // Crab
-    tangram.getChild(3)->rotateCrab(90.0f, RotateAxisX);
-    tangram.getChild(3)->translateCrab(Triangle4Translate);
-    tangram.getChild(4)->rotateCrab(180.0f, RotateAxisX);
-    tangram.getChild(4)->translateCrab(Triangle5Translate);
+    tangram[3]->rotateCrab(90.0f, RotateAxisX);
+    tangram[3]->translateCrab(Triangle4Translate);
+    tangram[4]->rotateCrab(180.0f, RotateAxisX);
+    tangram[4]->translateCrab(Triangle5Translate);
     // Cube
-    tangram.getChild(3)->rotateCube(-135.0f, RotateAxisY);
-    tangram.getChild(3)->rotateCube(90.0f, RotateAxisZ);
-    tangram.getChild(3)->translateCube(Triangle4Translate2);
-    tangram.getChild(4)->rotateCube(135.0f, RotateAxisY);
-    tangram.getChild(4)->rotateCube(90.0f, RotateAxisZ);
-    tangram.getChild(4)->translateCube(Triangle5Translate2);
+    tangram[3]->rotateCube(-135.0f, RotateAxisY);
+    tangram[3]->rotateCube(90.0f, RotateAxisZ);
+    tangram[3]->translateCube(Triangle4Translate2);
+    tangram[4]->rotateCube(135.0f, RotateAxisY);
+    tangram[4]->rotateCube(90.0f, RotateAxisZ);
+    tangram[4]->translateCube(Triangle5Translate2);
     ////Para
     //Crab
-    tangram.getChild(5)->translateCrab(ParaTranslate);
+    tangram[5]->translateCrab(ParaTranslate);
     //Cube
-    tangram.getChild(5)->rotateCube(-45.0f, RotateAxisY);
-    tangram.getChild(5)->rotateCube(90.0f, RotateAxisZ);
-    tangram.getChild(5)->translateCube(ParaTranslate2);
+    tangram[5]->rotateCube(-45.0f, RotateAxisY);
+    tangram[5]->rotateCube(90.0f, RotateAxisZ);
+    tangram[5]->translateCube(ParaTranslate2);
     //Square
-    tangram.getChild(6)->rotateCube(45.0f, RotateAxisY);
+    tangram[6]->rotateCube(45.0f, RotateAxisY);
 
-    if (scene.left) {
-        progress += 0.01f;
-    } else if (scene.right) {
-        progress -= 0.01f;
-    }
+    scene.createAnimation(MorphSeconds);
+}
 
-    if (progress < 0.0f) {
-        progress = 0.0f;
-    } else if (progress > 1.0f) {
-        progress = 1.0f;
-    }
-    scene.draw(progress);
+void MyApp::drawScene(double elapsed) {
+    scene.camera->bind();
+    scene.draw(elapsed);
+    Stream->endFrame();
 }
 
 ////////////////////////////////////////////////////////////////////// CALLBACKS
@@ -421,23 +446,30 @@ void MyApp::keyCallback(GLFWwindow* win, int key, int scancode, int action, int
                 scene.orto = 1;
             }
         }
+        if (key == GLFW_KEY_O) {
+            scene.occlusion = !scene.occlusion;
+        }
         if (key == GLFW_KEY_LEFT) {
             if (!scene.right) {
                 scene.left = 1;
+                scene.animator.play();
             }
         }
         if (key == GLFW_KEY_RIGHT) {
             if (!scene.left) {
                 scene.right = 1;
+                scene.animator.reverse();
             }
         }
     }
     if (action == GLFW_RELEASE) {
-        if (key == GLFW_KEY_LEFT) {
+        if (key == GLFW_KEY_LEFT && scene.left) {
             scene.left = 0;
+            scene.animator.pause();
         }
-        if (key == GLFW_KEY_RIGHT) {
+        if (key == GLFW_KEY_RIGHT && scene.right) {
             scene.right = 0;
+            scene.animator.pause();
         }
     }
 }
@@ -446,6 +478,7 @@ void MyApp::mouseButtonCallback(GLFWwindow* win, int button, int action, int mod
     if (action == GLFW_PRESS && button == GLFW_MOUSE_BUTTON_LEFT) {
         glfwGetCursorPos(win, &cursor_x_pos, &cursor_y_pos);
         pressing = true;
+        pick(win, cursor_x_pos, cursor_y_pos);
     }
     else if (action == GLFW_RELEASE && button == GLFW_MOUSE_BUTTON_LEFT){
         glfwGetCursorPos(win, &cursor_x_pos, &cursor_y_pos);
@@ -453,6 +486,35 @@ void MyApp::mouseButtonCallback(GLFWwindow* win, int button, int action, int mod
     }
 }
 
+// Casts a ray from the near to the far plane through the cursor
+void MyApp::pick(GLFWwindow* win, double xpos, double ypos) {
+    int width, height, fb_width, fb_height;
+    glfwGetWindowSize(win, &width, &height);
+    glfwGetFramebufferSize(win, &fb_width, &fb_height);
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    // Cursor in framebuffer pixels, origin at the bottom left
+    const float x = static_cast<float>(xpos * fb_width / width);
+    const float y = static_cast<float>(fb_height - ypos * fb_height / height);
+    const glm::vec4 rect(viewport[0], viewport[1], viewport[2], viewport[3]);
+    const glm::mat4 view = scene.camera->getViewMatrix();
+    const glm::mat4 projection = scene.camera->getProjectionMatrix();
+    const glm::vec3 nearPoint = glm::unProject(glm::vec3(x, y, 0.0f), view, projection, rect);
+    const glm::vec3 farPoint = glm::unProject(glm::vec3(x, y, 1.0f), view, projection, rect);
+
+#ifdef DEBUG
+    typedef std::chrono::steady_clock clock;
+    const clock::time_point start = clock::now();
+#endif
+    picked = scene.pick(mgl::Ray(nearPoint, farPoint - nearPoint, 1.0f));
+#ifdef DEBUG
+    std::cout << "Picked piece " << picked << " in "
+              << std::chrono::duration<double, std::milli>(clock::now() - start).count()
+              << " ms" << std::endl;
+#endif
+}
+
 void MyApp::cursorCallback(GLFWwindow* win, double xpos, double ypos) {
     float rotationSpeed = 0.5f; // Adjust for sensitivity
 
@@ -496,11 +558,10 @@ void MyApp::cursorCallback(GLFWwindow* win, double xpos, double ypos) {
 }
 
 void MyApp::initCallback(GLFWwindow* win) {
-    scene.setRootNode(&tangram);
-
     createMeshes();
-    createShaderPrograms();  // after mesh;
+    createLayouts();
     createCameras();
+    createShaderPrograms();  // after mesh and stream buffer;
 }
 
 void MyApp::windowSizeCallback(GLFWwindow* win, int width, int height) {
@@ -513,7 +574,7 @@ void MyApp::windowSizeCallback(GLFWwindow* win, int width, int height) {
 }
 
 void MyApp::displayCallback(GLFWwindow* win, double elapsed) { 
-    drawScene();
+    drawScene(elapsed);
 }
 
 void MyApp::scrollCallback(GLFWwindow* win, double xpos, double ypos) {
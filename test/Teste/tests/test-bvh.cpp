@@ -0,0 +1,205 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Bvh queries checked against a linear scan
+//
+// Copyright (c) 2023-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "test.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "mgl/mglBvh.hpp"
+
+// Random boxes and triangles are put in a Bvh and queried with random rays
+// and boxes; every answer must match testing all primitives one by one.
+// The queries are repeated after moving the boxes and refitting the tree.
+// SceneGraph::raycast() and overlap() are these queries on the world boxes
+// of the scene, with Mesh::raycast() as the exact test.
+
+const size_t BOXES = 500;
+const size_t TRIANGLES = 300;
+const size_t QUERIES = 2000;
+
+static std::mt19937 generator(2024);
+
+static float uniform(float low, float high) {
+    return std::uniform_real_distribution<float>(low, high)(generator);
+}
+
+static glm::vec3 randomPoint(float extent) {
+    return glm::vec3(uniform(-extent, extent), uniform(-extent, extent),
+                     uniform(-extent, extent));
+}
+
+static mgl::BoundingBox randomBox() {
+    const glm::vec3 center = randomPoint(50.0f);
+    const glm::vec3 extent(uniform(0.1f, 5.0f), uniform(0.1f, 5.0f),
+                           uniform(0.1f, 5.0f));
+    mgl::BoundingBox box;
+    box.add(center - extent);
+    box.add(center + extent);
+    return box;
+}
+
+// Rays start anywhere, some inside boxes, and some are limited in length.
+static mgl::Ray randomRay() {
+    glm::vec3 direction = randomPoint(1.0f);
+    if (glm::dot(direction, direction) < 1e-4f) {
+        direction = glm::vec3(1.0f, 0.0f, 0.0f);
+    }
+    const float max_distance =
+        generator() % 4 == 0 ? uniform(1.0f, 100.0f) : FLT_MAX;
+    return mgl::Ray(randomPoint(60.0f), direction, max_distance);
+}
+
+static bool near(float a, float b) {
+    return std::fabs(a - b) <= 1e-4f * std::max(1.0f, std::fabs(a));
+}
+
+// Nearest hit by brute force: distance, or negative when nothing is hit.
+template <typename F> static float nearest(size_t n, F distance) {
+    float best = -1.0f;
+    for (size_t i = 0; i < n; i++) {
+        const float d = distance(static_cast<uint32_t>(i));
+        if (d >= 0.0f && (best < 0.0f || d < best)) {
+            best = d;
+        }
+    }
+    return best;
+}
+
+static void checkBoxQueries(const mgl::Bvh& bvh,
+                            const std::vector<mgl::BoundingBox>& boxes) {
+    int mismatches = 0;
+    for (size_t q = 0; q < QUERIES; q++) {
+        const mgl::Ray ray = randomRay();
+        const float expected = nearest(
+            boxes.size(), [&](uint32_t i) { return intersect(ray, boxes[i]); });
+        mgl::Bvh::Hit hit;
+        const bool found = bvh.raycast(ray, hit);
+        bool same = found == (expected >= 0.0f) &&
+                    bvh.intersects(ray) == (expected >= 0.0f);
+        if (found && same) {
+            // Ties may return any of the nearest boxes.
+            same = near(hit.distance, expected) &&
+                   near(intersect(ray, boxes[hit.primitive]), expected);
+        }
+
+        const mgl::BoundingBox query = randomBox();
+        std::vector<uint32_t> primitives, scan;
+        bvh.overlap(query, primitives);
+        for (uint32_t i = 0; i < boxes.size(); i++) {
+            if (boxes[i].overlaps(query)) {
+                scan.push_back(i);
+            }
+        }
+        std::sort(primitives.begin(), primitives.end());
+        same = same && primitives == scan;
+        mismatches += same ? 0 : 1;
+    }
+    CHECK(mismatches == 0);
+}
+
+static void checkBoxes() {
+    std::vector<mgl::BoundingBox> boxes(BOXES);
+    for (mgl::BoundingBox& box : boxes) {
+        box = randomBox();
+    }
+    mgl::Bvh bvh;
+    bvh.build(boxes.data(), boxes.size());
+    CHECK(bvh.size() == BOXES);
+    CHECK(bvh.getStats().leaves > 1);
+
+    // Every primitive is in exactly one leaf.
+    mgl::BoundingBox all;
+    all.add(glm::vec3(-1000.0f));
+    all.add(glm::vec3(1000.0f));
+    std::vector<uint32_t> primitives;
+    bvh.overlap(all, primitives);
+    std::sort(primitives.begin(), primitives.end());
+    CHECK(primitives.size() == BOXES);
+    CHECK(std::adjacent_find(primitives.begin(), primitives.end()) ==
+          primitives.end());
+
+    // A ray starting inside a box hits it at distance 0.
+    const mgl::Ray inside(boxes[7].getCenter(), glm::vec3(0.0f, 1.0f, 0.0f));
+    mgl::Bvh::Hit hit;
+    CHECK(bvh.raycast(inside, hit) && hit.distance == 0.0f);
+
+    checkBoxQueries(bvh, boxes);
+
+    // Moved boxes, queried through the refitted tree.
+    for (mgl::BoundingBox& box : boxes) {
+        const glm::vec3 offset = randomPoint(10.0f);
+        box.min += offset;
+        box.max += offset;
+    }
+    bvh.refit(boxes.data());
+    CHECK(bvh.size() == BOXES);
+    checkBoxQueries(bvh, boxes);
+}
+
+// The exact test narrows box hits to the triangles, as Mesh::raycast does.
+static void checkTriangles() {
+    std::vector<glm::vec3> corners(TRIANGLES * 3);
+    std::vector<mgl::BoundingBox> boxes(TRIANGLES);
+    for (size_t t = 0; t < TRIANGLES; t++) {
+        const glm::vec3 center = randomPoint(20.0f);
+        for (int k = 0; k < 3; k++) {
+            corners[3 * t + k] = center + randomPoint(3.0f);
+            boxes[t].add(corners[3 * t + k]);
+        }
+    }
+    mgl::Bvh bvh;
+    bvh.build(boxes.data(), boxes.size());
+    const mgl::Bvh::RayTest test = [&](uint32_t t, const mgl::Ray& ray) {
+        return intersect(ray, corners[3 * t], corners[3 * t + 1],
+                         corners[3 * t + 2]);
+    };
+
+    int mismatches = 0, hits = 0;
+    for (size_t q = 0; q < QUERIES; q++) {
+        // Aimed near the triangles so that a good part of the rays hit.
+        const glm::vec3 origin = randomPoint(40.0f);
+        const mgl::Ray ray(origin, randomPoint(15.0f) - origin);
+        const float expected = nearest(
+            TRIANGLES, [&](uint32_t t) { return test(t, ray); });
+        mgl::Bvh::Hit hit;
+        const bool found = bvh.raycast(ray, hit, test);
+        bool same = found == (expected >= 0.0f) &&
+                    bvh.intersects(ray, test) == (expected >= 0.0f);
+        if (found && same) {
+            same = near(hit.distance, expected) &&
+                   near(test(hit.primitive, ray), expected);
+        }
+        mismatches += same ? 0 : 1;
+        hits += found ? 1 : 0;
+    }
+    CHECK(mismatches == 0);
+    CHECK(hits > static_cast<int>(QUERIES / 10));
+}
+
+static void checkEmpty() {
+    mgl::Bvh bvh;
+    bvh.build(nullptr, 0);
+    CHECK(bvh.isEmpty());
+    mgl::Bvh::Hit hit;
+    const mgl::Ray ray(glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    CHECK(!bvh.raycast(ray, hit));
+    CHECK(!bvh.intersects(ray));
+    std::vector<uint32_t> primitives;
+    bvh.overlap(randomBox(), primitives);
+    CHECK(primitives.empty());
+}
+
+int main() {
+    checkBoxes();
+    checkTriangles();
+    checkEmpty();
+    return test::result("test-bvh");
+}
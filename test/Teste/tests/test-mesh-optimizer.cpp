@@ -0,0 +1,208 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Mesh optimization: vertex cache, overdraw and vertex fetch passes
+//
+// Copyright (c) 2023-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "test.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "mgl/mglMeshOptimizer.hpp"
+
+// The models are read with a minimal OBJ reader that, like Assimp with
+// aiProcess_JoinIdenticalVertices, makes one vertex per distinct v/vt/vn
+// corner and fans polygons into triangles.
+
+struct Model {
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+};
+
+static bool readObj(const std::string& filename, Model& model) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::vector<glm::vec3> v;
+    std::map<std::string, unsigned int> corners;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream in(line);
+        std::string type;
+        in >> type;
+        if (type == "v") {
+            glm::vec3 p;
+            in >> p.x >> p.y >> p.z;
+            v.push_back(p);
+        } else if (type == "f") {
+            std::vector<unsigned int> face;
+            std::string corner;
+            while (in >> corner) {
+                auto i = corners.find(corner);
+                if (i == corners.end()) {
+                    const size_t position = std::stoul(corner) - 1;
+                    i = corners.insert({corner, static_cast<unsigned int>(
+                                                    model.positions.size())})
+                            .first;
+                    model.positions.push_back(v[position]);
+                }
+                face.push_back(i->second);
+            }
+            for (size_t k = 2; k < face.size(); k++) {
+                model.indices.insert(model.indices.end(),
+                                     {face[0], face[k - 1], face[k]});
+            }
+        }
+    }
+    return !model.indices.empty();
+}
+
+// Appends b to a, as a MeshArena packs meshes into one buffer.
+static void append(Model& a, const Model& b) {
+    const unsigned int base = static_cast<unsigned int>(a.positions.size());
+    a.positions.insert(a.positions.end(), b.positions.begin(),
+                       b.positions.end());
+    for (const unsigned int index : b.indices) {
+        a.indices.push_back(base + index);
+    }
+}
+
+// Same triangles in a scrambled order, as a poor exporter might write them.
+static std::vector<unsigned int> shuffleTriangles(
+    const std::vector<unsigned int>& indices) {
+    std::vector<size_t> order(indices.size() / 3);
+    for (size_t t = 0; t < order.size(); t++) {
+        order[t] = t;
+    }
+    std::mt19937 random(2024);
+    std::shuffle(order.begin(), order.end(), random);
+    std::vector<unsigned int> shuffled;
+    for (const size_t t : order) {
+        shuffled.insert(shuffled.end(), indices.begin() + 3 * t,
+                        indices.begin() + 3 * t + 3);
+    }
+    return shuffled;
+}
+
+typedef std::vector<std::vector<unsigned int>> Triangles;
+
+// Triangles with their corners rotated to start at the smallest index, in
+// sorted order: equal for two index lists holding the same triangles.
+static Triangles canonical(const std::vector<unsigned int>& indices) {
+    Triangles triangles;
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        std::vector<unsigned int> triangle(indices.begin() + t,
+                                           indices.begin() + t + 3);
+        std::rotate(triangle.begin(),
+                    std::min_element(triangle.begin(), triangle.end()),
+                    triangle.end());
+        triangles.push_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+struct Improvement {
+    mgl::VertexCacheStats before, after;
+};
+
+static Improvement checkModel(const std::string& name, const Model& model,
+                              bool shuffle) {
+    const size_t n = model.positions.size();
+    std::vector<unsigned int> indices =
+        shuffle ? shuffleTriangles(model.indices) : model.indices;
+    const Triangles original = canonical(indices);
+
+    const mgl::VertexCacheStats before = mgl::analyzeVertexCache(indices, n);
+    std::vector<unsigned int> optimized = indices;
+    mgl::optimizeVertexCache(optimized, n);
+    const mgl::VertexCacheStats after = mgl::analyzeVertexCache(optimized, n);
+    std::printf("%-27s ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", name.c_str(),
+                before.acmr, after.acmr, before.atvr, after.atvr);
+
+    CHECK(canonical(optimized) == original);
+    CHECK(after.acmr <= before.acmr);
+    CHECK(after.atvr <= before.atvr);
+    // Every vertex is loaded once: the best possible for these meshes.
+    CHECK(after.atvr == 1.0f);
+
+    // Deterministic, so results can be cached.
+    std::vector<unsigned int> again = indices;
+    mgl::optimizeVertexCache(again, n);
+    CHECK(again == optimized);
+
+    // Overdraw ordering stays within its ACMR threshold.
+    std::vector<unsigned int> overdraw = optimized;
+    mgl::optimizeOverdraw(overdraw, model.positions.data(), n, 1.05f);
+    CHECK(canonical(overdraw) == original);
+    CHECK(mgl::analyzeVertexCache(overdraw, n).acmr <= after.acmr * 1.05f);
+
+    // Fetch order: vertices are renumbered in order of first use.
+    std::vector<unsigned int> fetch = overdraw;
+    std::vector<unsigned int> remap;
+    mgl::optimizeVertexFetch(fetch, n, remap);
+    std::vector<glm::vec3> positions = model.positions;
+    mgl::remapVertices(positions.data(), remap);
+    unsigned int next = 0;
+    bool first_use_order = true;
+    for (const unsigned int v : fetch) {
+        if (v > next) {
+            first_use_order = false;
+        }
+        next = std::max(next, v + 1);
+    }
+    CHECK(first_use_order);
+    for (size_t i = 0; i < overdraw.size(); i++) {
+        CHECK(positions[fetch[i]] == model.positions[overdraw[i]]);
+    }
+    return {before, after};
+}
+
+int main(int argc, char* argv[]) {
+    const std::string models = argc > 1 ? argv[1] : "../models/";
+    Model cube, para, triangle;
+    CHECK(readObj(models + "Cube.obj", cube));
+    CHECK(readObj(models + "Para.obj", para));
+    CHECK(readObj(models + "TriangleFix.obj", triangle));
+    if (test::failures() > 0) {
+        return test::result("test-mesh-optimizer");
+    }
+
+    // The tangram: the square, the parallelogram and five triangles.
+    Model tangram = cube;
+    append(tangram, para);
+    for (int i = 0; i < 5; i++) {
+        append(tangram, triangle);
+    }
+
+    // As exported, the models are already in an optimal order. Scrambled,
+    // they miss the cache and the pass must recover, except for the triangle
+    // whose 18 vertices all fit in the cache in any order.
+    const struct {
+        const char* name;
+        const Model& model;
+        bool improves;
+    } cases[] = {{"Cube.obj", cube, true},
+                 {"Para.obj", para, true},
+                 {"TriangleFix.obj", triangle, false},
+                 {"tangram", tangram, true}};
+    for (const auto& c : cases) {
+        checkModel(c.name, c.model, false);
+        const Improvement shuffled =
+            checkModel(std::string(c.name) + " (shuffled)", c.model, true);
+        if (c.improves) {
+            CHECK(shuffled.after.acmr < shuffled.before.acmr);
+            CHECK(shuffled.after.atvr < shuffled.before.atvr);
+        }
+    }
+    return test::result("test-mesh-optimizer");
+}
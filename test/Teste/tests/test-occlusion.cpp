@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// OcclusionCuller: boxes hidden behind, beside and across the near plane
+//
+// Copyright (c) 2023-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "test.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "mgl/mglOcclusion.hpp"
+
+// The camera at z = 10 looks down -z at a large square occluder in the z = 0
+// plane, 8 units wide. Boxes are placed around it and must be culled only
+// when they are entirely hidden. Every case runs with one worker thread and
+// with one per core.
+
+const glm::vec3 SQUARE[] = {
+    {-1.0f, -1.0f, 0.0f}, {1.0f, -1.0f, 0.0f}, {1.0f, 1.0f, 0.0f},
+    {-1.0f, -1.0f, 0.0f}, {1.0f, 1.0f, 0.0f},  {-1.0f, 1.0f, 0.0f}};
+// The same square wound clockwise, seen from its back.
+const glm::vec3 SQUARE_BACK[] = {
+    {-1.0f, -1.0f, 0.0f}, {1.0f, 1.0f, 0.0f},  {1.0f, -1.0f, 0.0f},
+    {-1.0f, -1.0f, 0.0f}, {-1.0f, 1.0f, 0.0f}, {1.0f, 1.0f, 0.0f}};
+
+static mgl::BoundingBox makeBox(const glm::vec3& min, const glm::vec3& max) {
+    mgl::BoundingBox box;
+    box.add(min);
+    box.add(max);
+    return box;
+}
+
+static glm::mat4 viewProjection() {
+    const glm::mat4 view =
+        glm::lookAt(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f),
+                    glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::mat4 projection =
+        glm::perspective(glm::radians(60.0f), 2.0f, 0.5f, 100.0f);
+    return projection * view;
+}
+
+static void checkOccluder(unsigned int n_threads) {
+    mgl::OcclusionCuller culler(256, 128, n_threads);
+    const glm::mat4 square = glm::scale(glm::mat4(1.0f), glm::vec3(4.0f));
+    culler.begin(viewProjection());
+    culler.addOccluder(SQUARE, 2, square);
+    culler.rasterize();
+    CHECK(culler.getStats().occluderTriangles == 2);
+    CHECK(culler.getStats().rasterizedTriangles == 2);
+
+    // Fully behind the square.
+    CHECK(!culler.isVisible(
+        makeBox(glm::vec3(-1.0f, -1.0f, -6.0f), glm::vec3(1.0f, 1.0f, -4.0f))));
+    // In front of the square.
+    CHECK(culler.isVisible(
+        makeBox(glm::vec3(-1.0f, -1.0f, 1.0f), glm::vec3(1.0f, 1.0f, 2.0f))));
+    // Behind it, but reaching out past its right edge.
+    CHECK(culler.isVisible(
+        makeBox(glm::vec3(3.0f, -1.0f, -6.0f), glm::vec3(12.0f, 1.0f, -4.0f))));
+    // Behind the plane of the square, beside it.
+    CHECK(culler.isVisible(makeBox(glm::vec3(-14.0f, -1.0f, -6.0f),
+                                   glm::vec3(-9.0f, 1.0f, -4.0f))));
+    // Crossing the near plane (z = 9.5) in front of the camera.
+    CHECK(culler.isVisible(
+        makeBox(glm::vec3(-0.2f, -0.2f, 9.0f), glm::vec3(0.2f, 0.2f, 12.0f))));
+    // Crossing the near plane and reaching all the way behind the square.
+    CHECK(culler.isVisible(
+        makeBox(glm::vec3(-0.2f, -0.2f, -6.0f), glm::vec3(0.2f, 0.2f, 9.8f))));
+    CHECK(culler.getStats().tested == 6);
+    CHECK(culler.getStats().occluded == 1);
+
+    // Seen from its back, the square occludes nothing.
+    culler.begin(viewProjection());
+    culler.addOccluder(SQUARE_BACK, 2, square);
+    culler.rasterize();
+    CHECK(culler.getStats().rasterizedTriangles == 0);
+    CHECK(culler.isVisible(
+        makeBox(glm::vec3(-1.0f, -1.0f, -6.0f), glm::vec3(1.0f, 1.0f, -4.0f))));
+
+    // Nor does a square behind the camera.
+    culler.begin(viewProjection());
+    culler.addOccluder(SQUARE, 2,
+                       glm::translate(glm::mat4(1.0f),
+                                      glm::vec3(0.0f, 0.0f, 12.0f)) *
+                           square);
+    culler.rasterize();
+    CHECK(culler.isVisible(
+        makeBox(glm::vec3(-1.0f, -1.0f, -6.0f), glm::vec3(1.0f, 1.0f, -4.0f))));
+}
+
+int main() {
+    checkOccluder(1);
+    checkOccluder(0);
+    return test::result("test-occlusion");
+}
@@ -0,0 +1,48 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Test Helpers
+//
+// Copyright (c) 2023-24 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TEST_HPP
+#define TEST_HPP
+
+#include <cstdio>
+#include <cstdlib>
+
+// Each test is a program that checks conditions with CHECK() and returns
+// test::result() from main(): 0 when every check passed.
+
+namespace test {
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+inline void check(bool passed, const char* condition, const char* file,
+                  int line) {
+    if (!passed) {
+        std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line,
+                     condition);
+        failures()++;
+    }
+}
+
+inline int result(const char* name) {
+    if (failures() == 0) {
+        std::printf("%s: passed\n", name);
+        return EXIT_SUCCESS;
+    }
+    std::printf("%s: %d check(s) failed\n", name, failures());
+    return EXIT_FAILURE;
+}
+
+} // namespace test
+
+#define CHECK(condition) \
+    test::check((condition), #condition, __FILE__, __LINE__)
+
+#endif /* TEST_HPP */